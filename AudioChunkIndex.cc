@@ -0,0 +1,225 @@
+//=======================================================================
+/** @file AudioChunkIndex.cc
+ *
+ * See AudioChunkIndex.h. RIFF and RF64 sizes are little endian and FORM sizes
+ * are big endian. In all three, a chunk with an odd size is followed by a
+ * padding byte.
+ */
+//=======================================================================
+
+#include "AudioChunkIndex.h"
+#include <algorithm>
+
+//=============================================================
+static uint32_t readLittleEndian32 (const uint8_t* bytes)
+{
+    return ((uint32_t)bytes[3] << 24) | (bytes[2] << 16) | (bytes[1] << 8) | bytes[0];
+}
+
+//=============================================================
+static uint64_t readLittleEndian64 (const uint8_t* bytes)
+{
+    return ((uint64_t)readLittleEndian32 (bytes + 4) << 32) | readLittleEndian32 (bytes);
+}
+
+//=============================================================
+AudioChunkIndex::AudioChunkIndex()
+{
+    clear();
+}
+
+//=============================================================
+void AudioChunkIndex::clear()
+{
+    chunks.clear();
+    container = Container::Unknown;
+    formType.clear();
+    fileSize = 0;
+    ds64DataSize = 0;
+    ds64Table.clear();
+}
+
+//=============================================================
+bool AudioChunkIndex::build (const uint8_t* fileData, size_t newFileSize)
+{
+    clear();
+    fileSize = newFileSize;
+
+    if (fileSize < 12 || ! readHeader (fileData))
+        return false;
+
+    uint64_t offset = 12;
+
+    while (offset + 8 <= fileSize)
+    {
+        uint64_t chunkStart = offset;
+
+        if (! addChunk (fileData + chunkStart, chunkStart + 8, offset))
+            break;
+
+        if (container == Container::Rf64 && chunks.size() == 1 && chunks[0].id == "ds64")
+            readDs64 (fileData + chunkStart + 8, getSizeInFile (chunks[0]));
+    }
+
+    return true;
+}
+
+//=============================================================
+bool AudioChunkIndex::build (std::istream& file)
+{
+    clear();
+
+    file.clear();
+    file.seekg (0, std::ios::end);
+    std::streamoff length = file.tellg();
+    fileSize = length > 0 ? (uint64_t)length : 0;
+    file.seekg (0, std::ios::beg);
+
+    uint8_t header[12];
+
+    if (fileSize < 12 || ! file.read ((char*)header, 12) || ! readHeader (header))
+    {
+        file.clear();
+        return false;
+    }
+
+    uint64_t offset = 12;
+    uint8_t chunkHeader[8];
+
+    while (offset + 8 <= fileSize)
+    {
+        file.seekg ((std::streamoff)offset);
+
+        uint64_t chunkStart = offset;
+
+        if (! file.read ((char*)chunkHeader, 8) || ! addChunk (chunkHeader, chunkStart + 8, offset))
+            break;
+
+        if (container == Container::Rf64 && chunks.size() == 1 && chunks[0].id == "ds64")
+        {
+            // the table is tiny, so the whole chunk is read, but a corrupt size is capped
+            std::vector<uint8_t> payload ((size_t)std::min (getSizeInFile (chunks[0]), (uint64_t)65536));
+
+            if (file.read ((char*)payload.data(), (std::streamsize)payload.size()))
+                readDs64 (payload.data(), payload.size());
+        }
+    }
+
+    file.clear();
+    return true;
+}
+
+//=============================================================
+bool AudioChunkIndex::readHeader (const uint8_t* header)
+{
+    std::string id (header, header + 4);
+
+    if (id == "RIFF")
+        container = Container::Riff;
+    else if (id == "RF64" || id == "BW64")
+        container = Container::Rf64;
+    else if (id == "FORM")
+        container = Container::Form;
+    else
+        return false;
+
+    formType.assign (header + 8, header + 12);
+    return true;
+}
+
+//=============================================================
+bool AudioChunkIndex::addChunk (const uint8_t* chunkHeader, uint64_t offset, uint64_t& nextOffset)
+{
+    std::string id (chunkHeader, chunkHeader + 4);
+    uint64_t size;
+
+    if (container == Container::Form)
+        size = ((uint32_t)chunkHeader[4] << 24) | (chunkHeader[5] << 16) | (chunkHeader[6] << 8) | chunkHeader[7];
+    else
+        size = readLittleEndian32 (chunkHeader + 4);
+
+    if (container == Container::Rf64 && size == 0xFFFFFFFF)
+        size = getDs64Size (id);
+
+    chunks.push_back ({ id, offset, size });
+
+    // a chunk that runs off the end of the file must be the last one
+    nextOffset = offset + size + (size & 1);
+    return nextOffset <= fileSize;
+}
+
+//=============================================================
+void AudioChunkIndex::readDs64 (const uint8_t* payload, uint64_t size)
+{
+    // riff size (8 bytes), data size (8), sample count (8), table length (4), then the table
+    if (size < 28)
+        return;
+
+    ds64DataSize = readLittleEndian64 (payload + 8);
+
+    uint64_t tableLength = readLittleEndian32 (payload + 24);
+
+    for (uint64_t i = 0; i < tableLength && 28 + (i + 1) * 12 <= size; i++)
+    {
+        const uint8_t* entry = payload + 28 + i * 12;
+        ds64Table.push_back ({ std::string (entry, entry + 4), readLittleEndian64 (entry + 4) });
+    }
+}
+
+//=============================================================
+uint64_t AudioChunkIndex::getDs64Size (const std::string& id) const
+{
+    if (id == "data")
+        return ds64DataSize;
+
+    for (const auto& entry : ds64Table)
+    {
+        if (entry.first == id)
+            return entry.second;
+    }
+
+    // no 64-bit size was given, so 0xFFFFFFFF is taken at its word
+    return 0xFFFFFFFF;
+}
+
+//=============================================================
+const AudioChunk* AudioChunkIndex::find (const std::string& id) const
+{
+    for (const AudioChunk& chunk : chunks)
+    {
+        if (chunk.id == id)
+            return &chunk;
+    }
+
+    return nullptr;
+}
+
+//=============================================================
+const std::vector<AudioChunk>& AudioChunkIndex::getChunks() const
+{
+    return chunks;
+}
+
+//=============================================================
+AudioChunkIndex::Container AudioChunkIndex::getContainer() const
+{
+    return container;
+}
+
+//=============================================================
+const std::string& AudioChunkIndex::getFormType() const
+{
+    return formType;
+}
+
+//=============================================================
+uint64_t AudioChunkIndex::getFileSize() const
+{
+    return fileSize;
+}
+
+//=============================================================
+uint64_t AudioChunkIndex::getSizeInFile (const AudioChunk& chunk) const
+{
+    return std::min (chunk.size, fileSize - std::min (fileSize, chunk.offset));
+}
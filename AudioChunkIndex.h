@@ -0,0 +1,119 @@
+//=======================================================================
+/** @file AudioChunkIndex.h
+ *
+ * A walker for the chunks of .wav (RIFF and RF64) and .aiff (FORM) files. It follows
+ * the size field of each chunk from one to the next, so finding the format
+ * and audio data costs one step per chunk, and bytes inside the audio data or
+ * metadata can never be mistaken for a chunk ID. The result is a small index
+ * of where every chunk starts, which can be used to seek straight to the PCM
+ * data.
+ *
+ * RF64 (and BW64, its EBU twin) is the WAVE format for files over 4GB. Chunks
+ * too big for their 32-bit size field give it as 0xFFFFFFFF, and the real
+ * 64-bit sizes are kept in a "ds64" chunk right after the header. The index
+ * looks them up, so callers see the true size of every chunk.
+ */
+//=======================================================================
+
+#ifndef _AS_AudioChunkIndex_h
+#define _AS_AudioChunkIndex_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <istream>
+#include <utility>
+
+//=============================================================
+/** One chunk of a file, as found by AudioChunkIndex */
+struct AudioChunk
+{
+    /** The four character ID of the chunk, e.g. "fmt ", "data", "LIST", "cue ", "smpl", "COMM" or "SSND" */
+    std::string id;
+
+    /** The position in the file of the first byte after the chunk's 8-byte header */
+    uint64_t offset;
+
+    /** The size of the chunk, not counting its header or padding, as given in the file.
+     * It can claim more bytes than are left in a truncated file.
+     */
+    uint64_t size;
+};
+
+//=============================================================
+/** The chunks of a .wav or .aiff file, in the order they appear */
+class AudioChunkIndex
+{
+public:
+
+    //=============================================================
+    /** The kinds of container the index understands */
+    enum class Container
+    {
+        Unknown,
+        Riff,
+        Rf64,
+        Form
+    };
+
+    //=============================================================
+    /** Constructor. The index is empty until build() is called */
+    AudioChunkIndex();
+
+    //=============================================================
+    /** Indexes the chunks of a file held in memory.
+     * @Returns true if the file is a RIFF, RF64 or FORM container
+     */
+    bool build (const uint8_t* fileData, size_t fileSize);
+
+    /** Indexes the chunks of an open file, reading only the header of each chunk.
+     * The stream is left in a good state, at an unspecified position.
+     * @Returns true if the file is a RIFF, RF64 or FORM container
+     */
+    bool build (std::istream& file);
+
+    /** Empties the index */
+    void clear();
+
+    //=============================================================
+    /** @Returns the first chunk with the given ID, or nullptr if there isn't one */
+    const AudioChunk* find (const std::string& id) const;
+
+    /** @Returns every chunk, in the order they appear in the file */
+    const std::vector<AudioChunk>& getChunks() const;
+
+    /** @Returns the kind of container indexed */
+    Container getContainer() const;
+
+    /** @Returns the form type from the file's header, e.g. "WAVE" or "AIFF" */
+    const std::string& getFormType() const;
+
+    /** @Returns the size of the file that was indexed */
+    uint64_t getFileSize() const;
+
+    /** @Returns the number of bytes of a chunk that are actually in the file, which
+     * is less than its size if the file has been cut short
+     */
+    uint64_t getSizeInFile (const AudioChunk& chunk) const;
+
+private:
+
+    //=============================================================
+    bool readHeader (const uint8_t* header);
+    bool addChunk (const uint8_t* chunkHeader, uint64_t offset, uint64_t& nextOffset);
+    void readDs64 (const uint8_t* payload, uint64_t size);
+    uint64_t getDs64Size (const std::string& id) const;
+
+    //=============================================================
+    std::vector<AudioChunk> chunks;
+    Container container;
+    std::string formType;
+    uint64_t fileSize;
+
+    // the 64-bit sizes from an RF64 file's ds64 chunk
+    uint64_t ds64DataSize;
+    std::vector<std::pair<std::string, uint64_t>> ds64Table;
+};
+
+#endif /* _AS_AudioChunkIndex_h */
@@ -21,9 +21,19 @@
 //=======================================================================
 
 #include "AudioFile.h"
+#include "PcmKernels.h"
 #include <fstream>
+#include <cstdio>
 #include <unordered_map>
-#include <iterator>
+#include <algorithm>
+
+#if defined (__unix__) || defined (__APPLE__)
+#define AUDIOFILE_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 //=============================================================
 // Pre-defined 10-byte representations of common sample rates
@@ -49,14 +59,72 @@ std::unordered_map <uint32_t, std::vector<uint8_t>> aiffSampleRateTable = {
     {5644800, {64, 21, 172, 68, 0, 0, 0, 0, 0, 0}}
 };
 
+//=============================================================
+// A read-only mapping of a whole file, unmapped when it goes out of scope
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() : data (nullptr), size (0) {}
+    
+    ~MemoryMappedFile()
+    {
+#if AUDIOFILE_HAS_MMAP
+        if (data != nullptr)
+            munmap ((void*)data, size);
+#endif
+    }
+    
+    bool open (const std::string& filePath)
+    {
+#if AUDIOFILE_HAS_MMAP
+        int fd = ::open (filePath.c_str(), O_RDONLY);
+        
+        if (fd < 0)
+            return false;
+        
+        struct stat fileInfo;
+        
+        if (fstat (fd, &fileInfo) != 0 || fileInfo.st_size <= 0)
+        {
+            ::close (fd);
+            return false;
+        }
+        
+        void* mapping = mmap (nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        
+        // the mapping holds its own reference to the file
+        ::close (fd);
+        
+        if (mapping == MAP_FAILED)
+            return false;
+        
+        // we decode front to back, so let the kernel read ahead aggressively
+        madvise (mapping, (size_t)fileInfo.st_size, MADV_SEQUENTIAL);
+        
+        data = (const uint8_t*)mapping;
+        size = (size_t)fileInfo.st_size;
+        return true;
+#else
+        (void)filePath;
+        return false;
+#endif
+    }
+    
+    const uint8_t* data;
+    size_t size;
+    
+private:
+    MemoryMappedFile (const MemoryMappedFile&);
+    MemoryMappedFile& operator= (const MemoryMappedFile&);
+};
+
 //=============================================================
 template <class T>
 AudioFile<T>::AudioFile()
 {
     bitDepth = 16;
     sampleRate = 44100;
-    samples.resize (1);
-    samples[0].resize (0);
+    samples.setSize (1, 0);
     audioFileFormat = AudioFileFormat::NotLoaded;
 }
 
@@ -71,7 +139,7 @@ uint32_t AudioFile<T>::getSampleRate() const
 template <class T>
 int AudioFile<T>::getNumChannels() const
 {
-    return (int)samples.size();
+    return samples.getNumChannels();
 }
 
 //=============================================================
@@ -97,12 +165,12 @@ int AudioFile<T>::getBitDepth() const
 
 //=============================================================
 template <class T>
-int AudioFile<T>::getNumSamplesPerChannel() const
+int64_t AudioFile<T>::getNumSamplesPerChannel() const
 {
-    if (samples.size() > 0)
-        return (int) samples[0].size();
-    else
-        return 0;
+    if (headerOnlyReader != nullptr)
+        return headerOnlyReader->getNumSamplesPerChannel();
+    
+    return samples.getNumFrames();
 }
 
 //=============================================================
@@ -112,6 +180,54 @@ double AudioFile<T>::getLengthInSeconds() const
     return (double)getNumSamplesPerChannel() / (double)sampleRate;
 }
 
+//=============================================================
+template <class T>
+const AudioChunkIndex& AudioFile<T>::getChunkIndex() const
+{
+    return chunkIndex;
+}
+
+//=============================================================
+template <class T>
+bool AudioFile<T>::isHeaderOnly() const
+{
+    return headerOnlyReader != nullptr;
+}
+
+//=============================================================
+template <class T>
+int64_t AudioFile<T>::readFrames (int64_t startFrame, int64_t numFrames, AudioBufferView<T> destination)
+{
+    int numChannels = getNumChannels();
+    
+    if (startFrame < 0 || destination.getNumChannels() < numChannels)
+        return 0;
+    
+    numFrames = std::min (numFrames, std::min (destination.getNumFrames(), getNumSamplesPerChannel() - startFrame));
+    
+    if (numFrames <= 0)
+        return 0;
+    
+    if (headerOnlyReader != nullptr)
+    {
+        // seek straight to the first frame, so the cost depends only on the length of the range
+        std::lock_guard<std::mutex> lock (*headerOnlyReaderLock);
+        
+        if (! headerOnlyReader->seek (startFrame))
+            return 0;
+        
+        return headerOnlyReader->read (destination.getFrames (0, numFrames));
+    }
+    
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const T* source = samples[channel].data() + startFrame;
+        std::copy (source, source + numFrames, destination[channel].data());
+    }
+    
+    return numFrames;
+}
+
 //=============================================================
 template <class T>
 void AudioFile<T>::printSummary() const
@@ -137,21 +253,18 @@ bool AudioFile<T>::setAudioBuffer (AudioBuffer& newBuffer)
         return false;
     }
     
-    int numSamples = (int)newBuffer[0].size();
+    int64_t numSamples = (int64_t)newBuffer[0].size();
     
-    // set the number of channels
-    samples.resize (newBuffer.size());
+    // set the number of channels and samples
+    headerOnlyReader.reset();
+    samples.clear();
+    samples.setSize (numChannels, numSamples);
     
     for (int k = 0; k < getNumChannels(); k++)
     {
         assert (newBuffer[k].size() == numSamples);
         
-        samples[k].resize (numSamples);
-        
-        for (int i = 0; i < numSamples; i++)
-        {
-            samples[k][i] = newBuffer[k][i];
-        }
+        std::copy (newBuffer[k].begin(), newBuffer[k].begin() + numSamples, samples[k].begin());
     }
     
     return true;
@@ -159,47 +272,28 @@ bool AudioFile<T>::setAudioBuffer (AudioBuffer& newBuffer)
 
 //=============================================================
 template <class T>
-void AudioFile<T>::setAudioBufferSize (int numChannels, int numSamples)
+void AudioFile<T>::setAudioBufferSize (int numChannels, int64_t numSamples)
 {
-    samples.resize (numChannels);
-    setNumSamplesPerChannel (numSamples);
+    headerOnlyReader.reset();
+    samples.setSize (numChannels, numSamples);
 }
 
 //=============================================================
 template <class T>
-void AudioFile<T>::setNumSamplesPerChannel (int numSamples)
+void AudioFile<T>::setNumSamplesPerChannel (int64_t numSamples)
 {
-    int originalSize = getNumSamplesPerChannel();
-    
-    for (int i = 0; i < getNumChannels();i++)
-    {
-        samples[i].resize (numSamples);
-        
-        // set any new samples to zero
-        if (numSamples > originalSize)
-            std::fill (samples[i].begin() + originalSize, samples[i].end(), (T)0.);
-    }
+    // any new samples are set to zero
+    headerOnlyReader.reset();
+    samples.setSize (getNumChannels(), numSamples);
 }
 
 //=============================================================
 template <class T>
 void AudioFile<T>::setNumChannels (int numChannels)
 {
-    int originalNumChannels = getNumChannels();
-    int originalNumSamplesPerChannel = getNumSamplesPerChannel();
-    
-    samples.resize (numChannels);
-    
-    // make sure any new channels are set to the right size
-    // and filled with zeros
-    if (numChannels > originalNumChannels)
-    {
-        for (int i = originalNumChannels; i < numChannels; i++)
-        {
-            samples[i].resize (originalNumSamplesPerChannel);
-            std::fill (samples[i].begin(), samples[i].end(), (T)0.);
-        }
-    }
+    // any new channels are the right size and filled with zeros
+    headerOnlyReader.reset();
+    samples.setSize (numChannels, getNumSamplesPerChannel());
 }
 
 //=============================================================
@@ -218,8 +312,23 @@ void AudioFile<T>::setSampleRate (uint32_t newSampleRate)
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::load (std::string filePath)
+bool AudioFile<T>::load (std::string filePath, AudioFileLoadMode loadMode)
 {
+    headerOnlyReader.reset();
+    
+    if (loadMode == AudioFileLoadMode::HeaderOnly)
+        return openHeaderOnly (filePath);
+    
+    if (loadMode == AudioFileLoadMode::MemoryMapped)
+    {
+        MemoryMappedFile mappedFile;
+        
+        if (mappedFile.open (filePath))
+            return decodeFileData (mappedFile.data, mappedFile.size);
+        
+        // mapping isn't available here (or the file is empty), so read it in the usual way
+    }
+    
     std::ifstream file (filePath, std::ios::binary);
     
     // check the file exists
@@ -230,12 +339,53 @@ bool AudioFile<T>::load (std::string filePath)
         return false;
     }
     
-    file.unsetf (std::ios::skipws);
-    std::istream_iterator<uint8_t> begin (file), end;
-    std::vector<uint8_t> fileData (begin, end);
+    file.seekg (0, std::ios::end);
+    std::streamoff length = file.tellg();
+    file.seekg (0, std::ios::beg);
+    
+    std::vector<uint8_t> fileData (length > 0 ? (size_t)length : 0);
+    
+    if (! fileData.empty())
+        file.read ((char*)fileData.data(), (std::streamsize)fileData.size());
+    
+    return decodeFileData (fileData.data(), fileData.size());
+}
+
+//=============================================================
+template <class T>
+bool AudioFile<T>::openHeaderOnly (std::string filePath)
+{
+    std::shared_ptr<AudioFileReader<T>> reader (new AudioFileReader<T>());
+    
+    // the reader checks the format just as decodeWaveFile() does, without decoding any frames
+    if (! reader->open (filePath))
+    {
+        audioFileFormat = AudioFileFormat::Error;
+        return false;
+    }
+    
+    audioFileFormat = AudioFileFormat::Wave;
+    chunkIndex = reader->getChunkIndex();
+    sampleRate = reader->getSampleRate();
+    bitDepth = reader->getBitDepth();
+    
+    clearAudioBuffer();
+    samples.setSize (reader->getNumChannels(), 0);
+    headerOnlyReader = reader;
+    headerOnlyReaderLock = std::make_shared<std::mutex>();
     
+    return true;
+}
+
+//=============================================================
+template <class T>
+bool AudioFile<T>::decodeFileData (const uint8_t* fileData, size_t fileSize)
+{
     // get audio file format
-    audioFileFormat = determineAudioFileFormat (fileData);
+    audioFileFormat = determineAudioFileFormat (fileData, fileSize);
+    
+    // find the chunks by following their sizes from the start of the file
+    chunkIndex.build (fileData, fileSize);
     
     if (audioFileFormat == AudioFileFormat::Wave)
     {
@@ -243,7 +393,7 @@ bool AudioFile<T>::load (std::string filePath)
     }
     else if (audioFileFormat == AudioFileFormat::Aiff)
     {
-        return decodeAiffFile (fileData);
+        return decodeAiffFile (fileData, fileSize);
     }
     else
     {
@@ -254,22 +404,25 @@ bool AudioFile<T>::load (std::string filePath)
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
+bool AudioFile<T>::decodeWaveFile (const uint8_t* fileData)
 {
     // -----------------------------------------------------------
     // HEADER CHUNK
-    std::string headerChunkID (fileData.begin(), fileData.begin() + 4);
+    std::string headerChunkID (fileData, fileData + 4);
     //int32_t fileSizeInBytes = fourBytesToInt (fileData, 4) + 8;
-    std::string format (fileData.begin() + 8, fileData.begin() + 12);
+    std::string format (fileData + 8, fileData + 12);
+    
+    // RF64 and BW64 are the same as RIFF, except that the chunk index takes big sizes from the ds64 chunk
+    bool isRiff = headerChunkID == "RIFF" || headerChunkID == "RF64" || headerChunkID == "BW64";
     
     // -----------------------------------------------------------
-    // try and find the start points of key chunks
-    int indexOfDataChunk = getIndexOfString (fileData, "data");
-    int indexOfFormatChunk = getIndexOfString (fileData, "fmt");
+    // look up the key chunks in the chunk index
+    const AudioChunk* formatChunk = chunkIndex.find ("fmt ");
+    const AudioChunk* dataChunk = chunkIndex.find ("data");
     
     // if we can't find the data or format chunks, or the IDs/formats don't seem to be as expected
     // then it is unlikely we'll able to read this file, so abort
-    if (indexOfDataChunk == -1 || indexOfFormatChunk == -1 || headerChunkID != "RIFF" || format != "WAVE")
+    if (dataChunk == nullptr || formatChunk == nullptr || chunkIndex.getSizeInFile (*formatChunk) < 16 || ! isRiff || format != "WAVE")
     {
         std::cout << "ERROR: this doesn't seem to be a valid .WAV file" << std::endl;
         return false;
@@ -277,15 +430,13 @@ bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
     
     // -----------------------------------------------------------
     // FORMAT CHUNK
-    int f = indexOfFormatChunk;
-    std::string formatChunkID (fileData.begin() + f, fileData.begin() + f + 4);
-    //int32_t formatChunkSize = fourBytesToInt (fileData, f + 4);
-    int16_t audioFormat = twoBytesToInt (fileData, f + 8);
-    int16_t numChannels = twoBytesToInt (fileData, f + 10);
-    sampleRate = (uint32_t) fourBytesToInt (fileData, f + 12);
-    int32_t numBytesPerSecond = fourBytesToInt (fileData, f + 16);
-    int16_t numBytesPerBlock = twoBytesToInt (fileData, f + 20);
-    bitDepth = (int) twoBytesToInt (fileData, f + 22);
+    size_t f = (size_t) formatChunk->offset;
+    int16_t audioFormat = twoBytesToInt (fileData, f);
+    int16_t numChannels = twoBytesToInt (fileData, f + 2);
+    sampleRate = (uint32_t) fourBytesToInt (fileData, f + 4);
+    int32_t numBytesPerSecond = fourBytesToInt (fileData, f + 8);
+    int16_t numBytesPerBlock = twoBytesToInt (fileData, f + 12);
+    bitDepth = (int) twoBytesToInt (fileData, f + 14);
     
     int numBytesPerSample = bitDepth / 8;
     
@@ -319,72 +470,36 @@ bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
     
     // -----------------------------------------------------------
     // DATA CHUNK
-    int d = indexOfDataChunk;
-    std::string dataChunkID (fileData.begin() + d, fileData.begin() + d + 4);
-    int32_t dataChunkSize = fourBytesToInt (fileData, d + 4);
-    
-    int numSamples = dataChunkSize / (numChannels * bitDepth / 8);
-    int samplesStartIndex = indexOfDataChunk + 8;
+    // don't read past the end of the file if the data chunk claims more than is there
+    int64_t numSamples = (int64_t)(chunkIndex.getSizeInFile (*dataChunk) / numBytesPerBlock);
+    size_t samplesStartIndex = (size_t) dataChunk->offset;
     
     clearAudioBuffer();
-    samples.resize (numChannels);
-    
-    for (int i = 0; i < numSamples; i++)
-    {
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            int sampleIndex = samplesStartIndex + (numBytesPerBlock * i) + channel * numBytesPerSample;
-            
-            if (bitDepth == 8)
-            {
-                T sample = singleByteToSample (fileData[sampleIndex]);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = twoBytesToInt (fileData, sampleIndex);
-                T sample = sixteenBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsInt = 0;
-                sampleAsInt = (fileData[sampleIndex + 2] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
-                
-                if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
-                    sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
-
-                T sample = (T)sampleAsInt / (T)8388608.;
-                samples[channel].push_back (sample);
-            }
-            else
-            {
-                assert (false);
-            }
-        }
-    }
+    samples.setSize (numChannels, numSamples);
+    decodeSamples (fileData + samplesStartIndex, numSamples, false);
 
     return true;
 }
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
+bool AudioFile<T>::decodeAiffFile (const uint8_t* fileData, size_t fileSize)
 {
     // -----------------------------------------------------------
     // HEADER CHUNK
-    std::string headerChunkID (fileData.begin(), fileData.begin() + 4);
+    std::string headerChunkID (fileData, fileData + 4);
     //int32_t fileSizeInBytes = fourBytesToInt (fileData, 4, Endianness::BigEndian) + 8;
-    std::string format (fileData.begin() + 8, fileData.begin() + 12);
+    std::string format (fileData + 8, fileData + 12);
     
     // -----------------------------------------------------------
-    // try and find the start points of key chunks
-    int indexOfCommChunk = getIndexOfString (fileData, "COMM");
-    int indexOfSoundDataChunk = getIndexOfString (fileData, "SSND");
+    // look up the key chunks in the chunk index
+    const AudioChunk* commChunk = chunkIndex.find ("COMM");
+    const AudioChunk* soundDataChunk = chunkIndex.find ("SSND");
     
     // if we can't find the data or format chunks, or the IDs/formats don't seem to be as expected
     // then it is unlikely we'll able to read this file, so abort
-    if (indexOfSoundDataChunk == -1 || indexOfCommChunk == -1 || headerChunkID != "FORM" || format != "AIFF")
+    if (soundDataChunk == nullptr || commChunk == nullptr || chunkIndex.getSizeInFile (*commChunk) < 18
+        || chunkIndex.getSizeInFile (*soundDataChunk) < 8 || headerChunkID != "FORM" || format != "AIFF")
     {
         std::cout << "ERROR: this doesn't seem to be a valid AIFF file" << std::endl;
         return false;
@@ -392,13 +507,12 @@ bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
 
     // -----------------------------------------------------------
     // COMM CHUNK
-    int p = indexOfCommChunk;
-    std::string commChunkID (fileData.begin() + p, fileData.begin() + p + 4);
-    //int32_t commChunkSize = fourBytesToInt (fileData, p + 4, Endianness::BigEndian);
-    int16_t numChannels = twoBytesToInt (fileData, p + 8, Endianness::BigEndian);
-    int32_t numSamplesPerChannel = fourBytesToInt (fileData, p + 10, Endianness::BigEndian);
-    bitDepth = (int) twoBytesToInt (fileData, p + 14, Endianness::BigEndian);
-    sampleRate = getAiffSampleRate (fileData, p + 16);
+    size_t p = (size_t) commChunk->offset;
+    int16_t numChannels = twoBytesToInt (fileData, p, Endianness::BigEndian);
+    // the frame count is unsigned, so it can be up to 2^32 - 1
+    int64_t numSamplesPerChannel = (uint32_t) fourBytesToInt (fileData, p + 2, Endianness::BigEndian);
+    bitDepth = (int) twoBytesToInt (fileData, p + 6, Endianness::BigEndian);
+    sampleRate = getAiffSampleRate (fileData, p + 8);
     
     // check the sample rate was properly decoded
     if (sampleRate == -1)
@@ -423,69 +537,54 @@ bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
     
     // -----------------------------------------------------------
     // SSND CHUNK
-    int s = indexOfSoundDataChunk;
-    std::string soundDataChunkID (fileData.begin() + s, fileData.begin() + s + 4);
-    int32_t soundDataChunkSize = fourBytesToInt (fileData, s + 4, Endianness::BigEndian);
-    int32_t offset = fourBytesToInt (fileData, s + 8, Endianness::BigEndian);
-    //int32_t blockSize = fourBytesToInt (fileData, s + 12, Endianness::BigEndian);
+    size_t s = (size_t) soundDataChunk->offset;
+    int64_t soundDataChunkSize = (int64_t) soundDataChunk->size;
+    int32_t offset = fourBytesToInt (fileData, s, Endianness::BigEndian);
+    //int32_t blockSize = fourBytesToInt (fileData, s + 4, Endianness::BigEndian);
     
     int numBytesPerSample = bitDepth / 8;
     int numBytesPerFrame = numBytesPerSample * numChannels;
-    int totalNumAudioSampleBytes = numSamplesPerChannel * numBytesPerFrame;
-    int samplesStartIndex = s + 16 + (int)offset;
+    int64_t totalNumAudioSampleBytes = numSamplesPerChannel * numBytesPerFrame;
+    size_t samplesStartIndex = s + 8 + (uint32_t)offset;
         
     // sanity check the data
-    if ((soundDataChunkSize - 8) != totalNumAudioSampleBytes || totalNumAudioSampleBytes > (fileData.size() - samplesStartIndex))
+    if ((soundDataChunkSize - 8) != totalNumAudioSampleBytes || samplesStartIndex > fileSize || (uint64_t)totalNumAudioSampleBytes > (fileSize - samplesStartIndex))
     {
         std::cout << "ERROR: the metadatafor this file doesn't seem right" << std::endl;
         return false;
     }
     
     clearAudioBuffer();
-    samples.resize (numChannels);
+    samples.setSize (numChannels, numSamplesPerChannel);
+    decodeSamples (fileData + samplesStartIndex, numSamplesPerChannel, true);
     
-    for (int i = 0; i < numSamplesPerChannel; i++)
+    return true;
+}
+
+//=============================================================
+template <class T>
+void AudioFile<T>::decodeSamples (const uint8_t* sampleData, int64_t numFrames, bool isBigEndian)
+{
+    // the kernels count samples with an int, so files over 2GB are decoded a slice at a time
+    const int64_t maxFramesPerSlice = 1 << 24;
+    PcmFormat format = PcmKernels::getFormat (bitDepth, isBigEndian);
+    size_t numBytesPerFrame = (size_t) PcmKernels::getNumBytesPerSample (format) * samples.getNumChannels();
+    std::vector<T*> channels (samples.getNumChannels());
+    
+    for (int64_t sliceStart = 0; sliceStart < numFrames; sliceStart += maxFramesPerSlice)
     {
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            int sampleIndex = samplesStartIndex + (numBytesPerFrame * i) + channel * numBytesPerSample;
-            
-            if (bitDepth == 8)
-            {
-                int8_t sampleAsSigned8Bit = (int8_t)fileData[sampleIndex];
-                T sample = (T)sampleAsSigned8Bit / (T)128.;
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = twoBytesToInt (fileData, sampleIndex, Endianness::BigEndian);
-                T sample = sixteenBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsInt = 0;
-                sampleAsInt = (fileData[sampleIndex] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex + 2];
-                
-                if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
-                    sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
-                
-                T sample = (T)sampleAsInt / (T)8388608.;
-                samples[channel].push_back (sample);
-            }
-            else
-            {
-                assert (false);
-            }
-        }
+        int numSliceFrames = (int) std::min (maxFramesPerSlice, numFrames - sliceStart);
+        
+        for (int channel = 0; channel < samples.getNumChannels(); channel++)
+            channels[channel] = samples[channel].data() + sliceStart;
+        
+        PcmKernels::decode (sampleData + (size_t)sliceStart * numBytesPerFrame, format, samples.getNumChannels(), numSliceFrames, channels.data());
     }
-    
-    return true;
 }
 
 //=============================================================
 template <class T>
-uint32_t AudioFile<T>::getAiffSampleRate (std::vector<uint8_t>& fileData, int sampleRateStartIndex)
+uint32_t AudioFile<T>::getAiffSampleRate (const uint8_t* fileData, size_t sampleRateStartIndex)
 {
     for (auto it : aiffSampleRateTable)
     {
@@ -498,7 +597,7 @@ uint32_t AudioFile<T>::getAiffSampleRate (std::vector<uint8_t>& fileData, int sa
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::tenByteMatch (std::vector<uint8_t>& v1, int startIndex1, std::vector<uint8_t>& v2, int startIndex2)
+bool AudioFile<T>::tenByteMatch (const uint8_t* v1, size_t startIndex1, const std::vector<uint8_t>& v2, int startIndex2)
 {
     for (int i = 0; i < 10; i++)
     {
@@ -540,97 +639,69 @@ bool AudioFile<T>::save (std::string filePath, AudioFileFormat format)
 template <class T>
 bool AudioFile<T>::saveToWaveFile (std::string filePath)
 {
-    std::vector<uint8_t> fileData;
-    
-    int32_t dataChunkSize = getNumSamplesPerChannel() * (getNumChannels() * bitDepth / 8);
+    // stream the samples straight to disk rather than building the file in memory first
+    AudioFileWriter<T> writer;
     
-    // -----------------------------------------------------------
-    // HEADER CHUNK
-    addStringToFileData (fileData, "RIFF");
-    
-    // The file size in bytes is the header chunk size (4, not counting RIFF and WAVE) + the format
-    // chunk size (24) + the metadata part of the data chunk plus the actual data chunk size
-    int32_t fileSizeInBytes = 4 + 24 + 8 + dataChunkSize;
-    addInt32ToFileData (fileData, fileSizeInBytes);
-    
-    addStringToFileData (fileData, "WAVE");
-    
-    // -----------------------------------------------------------
-    // FORMAT CHUNK
-    addStringToFileData (fileData, "fmt ");
-    addInt32ToFileData (fileData, 16); // format chunk size (16 for PCM)
-    addInt16ToFileData (fileData, 1); // audio format = 1
-    addInt16ToFileData (fileData, (int16_t)getNumChannels()); // num channels
-    addInt32ToFileData (fileData, (int32_t)sampleRate); // sample rate
-    
-    int32_t numBytesPerSecond = (int32_t) ((getNumChannels() * sampleRate * bitDepth) / 8);
-    addInt32ToFileData (fileData, numBytesPerSecond);
+    if (headerOnlyReader == nullptr)
+    {
+        if (! writer.open (filePath, getNumChannels(), sampleRate, bitDepth))
+            return false;
+        
+        bool succeeded = writer.write (samples.getView());
+        return writer.close() && succeeded;
+    }
     
-    int16_t numBytesPerBlock = getNumChannels() * (bitDepth / 8);
-    addInt16ToFileData (fileData, numBytesPerBlock);
+    // a header-only file's frames are still being read from disk, perhaps from filePath itself,
+    // so they are copied to a temporary file that only replaces filePath once they are all there
+    std::string temporaryFilePath = filePath + ".part";
     
-    addInt16ToFileData (fileData, (int16_t)bitDepth);
+    if (! writer.open (temporaryFilePath, getNumChannels(), sampleRate, bitDepth))
+        return false;
     
-    // -----------------------------------------------------------
-    // DATA CHUNK
-    addStringToFileData (fileData, "data");
-    addInt32ToFileData (fileData, dataChunkSize);
+    PlanarAudioBuffer<T> block (getNumChannels(), 65536);
+    int64_t frame = 0, numFramesRead;
+    bool succeeded = true;
     
-    for (int i = 0; i < getNumSamplesPerChannel(); i++)
+    while (succeeded && (numFramesRead = readFrames (frame, block.getNumFrames(), block.getView())) > 0)
     {
-        for (int channel = 0; channel < getNumChannels(); channel++)
-        {
-            if (bitDepth == 8)
-            {
-                uint8_t byte = sampleToSingleByte (samples[channel][i]);
-                fileData.push_back (byte);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = sampleToSixteenBitInt (samples[channel][i]);
-                addInt16ToFileData (fileData, sampleAsInt);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsIntAgain = (int32_t) (samples[channel][i] * (T)8388608.);
-                
-                uint8_t bytes[3];
-                bytes[2] = (uint8_t) (sampleAsIntAgain >> 16) & 0xFF;
-                bytes[1] = (uint8_t) (sampleAsIntAgain >>  8) & 0xFF;
-                bytes[0] = (uint8_t) sampleAsIntAgain & 0xFF;
-                
-                fileData.push_back (bytes[0]);
-                fileData.push_back (bytes[1]);
-                fileData.push_back (bytes[2]);
-            }
-            else
-            {
-                assert (false && "Trying to write a file with unsupported bit depth");
-                return false;
-            }
-        }
+        succeeded = writer.write (block.getFrames (0, numFramesRead));
+        frame += numFramesRead;
     }
     
-    // check that the various sizes we put in the metadata are correct
-    if (fileSizeInBytes != (fileData.size() - 8) || dataChunkSize != (getNumSamplesPerChannel() * getNumChannels() * (bitDepth / 8)))
-    {
-        std::cout << "ERROR: couldn't save file to " << filePath << std::endl;
-        return false;
-    }
+    succeeded = writer.close() && succeeded && frame == getNumSamplesPerChannel();
     
-    // try to write the file
-    return writeDataToFile (fileData, filePath);
+    if (succeeded && std::rename (temporaryFilePath.c_str(), filePath.c_str()) == 0)
+        return true;
+    
+    std::cout << "ERROR: couldn't copy the audio of a header-only file to " << filePath << std::endl;
+    std::remove (temporaryFilePath.c_str());
+    return false;
 }
 
 //=============================================================
 template <class T>
 bool AudioFile<T>::saveToAiffFile (std::string filePath)
 {
+    // the whole file is encoded in memory, so its samples have to be loaded
+    if (headerOnlyReader != nullptr)
+    {
+        std::cout << "ERROR: a header-only file can only be saved as a .WAV file" << std::endl;
+        return false;
+    }
+    
     std::vector<uint8_t> fileData;
     
     int32_t numBytesPerSample = bitDepth / 8;
     int32_t numBytesPerFrame = numBytesPerSample * getNumChannels();
-    int32_t totalNumAudioSampleBytes = getNumSamplesPerChannel() * numBytesPerFrame;
+    
+    // AIFF has no 64-bit form, so its sizes must fit in 32 bits
+    if (getNumSamplesPerChannel() * numBytesPerFrame > 0x7FFFFFFF - 64)
+    {
+        std::cout << "ERROR: this audio is too long to save as an AIFF file, try saving it as a .WAV file" << std::endl;
+        return false;
+    }
+    
+    int32_t totalNumAudioSampleBytes = (int32_t)(getNumSamplesPerChannel() * numBytesPerFrame);
     int32_t soundDataChunkSize = totalNumAudioSampleBytes + 8;
     
     // -----------------------------------------------------------
@@ -649,7 +720,7 @@ bool AudioFile<T>::saveToAiffFile (std::string filePath)
     addStringToFileData (fileData, "COMM");
     addInt32ToFileData (fileData, 18, Endianness::BigEndian); // commChunkSize
     addInt16ToFileData (fileData, getNumChannels(), Endianness::BigEndian); // num channels
-    addInt32ToFileData (fileData, getNumSamplesPerChannel(), Endianness::BigEndian); // num samples per channel
+    addInt32ToFileData (fileData, (int32_t)getNumSamplesPerChannel(), Endianness::BigEndian); // num samples per channel
     addInt16ToFileData (fileData, bitDepth, Endianness::BigEndian); // bit depth
     addSampleRateToAiffData (fileData, sampleRate);
     
@@ -660,41 +731,21 @@ bool AudioFile<T>::saveToAiffFile (std::string filePath)
     addInt32ToFileData (fileData, 0, Endianness::BigEndian); // offset
     addInt32ToFileData (fileData, 0, Endianness::BigEndian); // block size
     
-    for (int i = 0; i < getNumSamplesPerChannel(); i++)
+    if (bitDepth != 8 && bitDepth != 16 && bitDepth != 24)
     {
-        for (int channel = 0; channel < getNumChannels(); channel++)
-        {
-            if (bitDepth == 8)
-            {
-                uint8_t byte = sampleToSingleByte (samples[channel][i]);
-                fileData.push_back (byte);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = sampleToSixteenBitInt (samples[channel][i]);
-                addInt16ToFileData (fileData, sampleAsInt, Endianness::BigEndian);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsIntAgain = (int32_t) (samples[channel][i] * (T)8388608.);
-                
-                uint8_t bytes[3];
-                bytes[0] = (uint8_t) (sampleAsIntAgain >> 16) & 0xFF;
-                bytes[1] = (uint8_t) (sampleAsIntAgain >>  8) & 0xFF;
-                bytes[2] = (uint8_t) sampleAsIntAgain & 0xFF;
-                
-                fileData.push_back (bytes[0]);
-                fileData.push_back (bytes[1]);
-                fileData.push_back (bytes[2]);
-            }
-            else
-            {
-                assert (false && "Trying to write a file with unsupported bit depth");
-                return false;
-            }
-        }
+        assert (false && "Trying to write a file with unsupported bit depth");
+        return false;
     }
     
+    std::vector<const T*> channelPointers (getNumChannels());
+    
+    for (int channel = 0; channel < getNumChannels(); channel++)
+        channelPointers[channel] = samples[channel].data();
+    
+    size_t headerSize = fileData.size();
+    fileData.resize (headerSize + totalNumAudioSampleBytes);
+    PcmKernels::encode (channelPointers.data(), PcmKernels::getFormat (bitDepth, true), getNumChannels(), (int)getNumSamplesPerChannel(), fileData.data() + headerSize);
+    
     // check that the various sizes we put in the metadata are correct
     if (fileSizeInBytes != (fileData.size() - 8) || soundDataChunkSize != getNumSamplesPerChannel() *  numBytesPerFrame + 8)
     {
@@ -714,12 +765,7 @@ bool AudioFile<T>::writeDataToFile (std::vector<uint8_t>& fileData, std::string
     
     if (outputFile.is_open())
     {
-        for (int i = 0; i < fileData.size(); i++)
-        {
-            char value = (char) fileData[i];
-            outputFile.write (&value, sizeof (char));
-        }
-        
+        outputFile.write ((const char*)fileData.data(), (std::streamsize)fileData.size());
         outputFile.close();
         
         return true;
@@ -786,21 +832,20 @@ void AudioFile<T>::addInt16ToFileData (std::vector<uint8_t>& fileData, int16_t i
 template <class T>
 void AudioFile<T>::clearAudioBuffer()
 {
-    for (int i = 0; i < samples.size();i++)
-    {
-        samples[i].clear();
-    }
-    
     samples.clear();
 }
 
 //=============================================================
 template <class T>
-AudioFileFormat AudioFile<T>::determineAudioFileFormat (std::vector<uint8_t>& fileData)
+AudioFileFormat AudioFile<T>::determineAudioFileFormat (const uint8_t* fileData, size_t fileSize)
 {
-    std::string header (fileData.begin(), fileData.begin() + 4);
+    // too small to hold even the header chunk
+    if (fileSize < 12)
+        return AudioFileFormat::Error;
+    
+    std::string header (fileData, fileData + 4);
     
-    if (header == "RIFF")
+    if (header == "RIFF" || header == "RF64" || header == "BW64")
         return AudioFileFormat::Wave;
     else if (header == "FORM")
         return AudioFileFormat::Aiff;
@@ -810,7 +855,7 @@ AudioFileFormat AudioFile<T>::determineAudioFileFormat (std::vector<uint8_t>& fi
 
 //=============================================================
 template <class T>
-int32_t AudioFile<T>::fourBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness)
+int32_t AudioFile<T>::fourBytesToInt (const uint8_t* source, size_t startIndex, Endianness endianness)
 {
     int32_t result;
     
@@ -824,7 +869,7 @@ int32_t AudioFile<T>::fourBytesToInt (std::vector<uint8_t>& source, int startInd
 
 //=============================================================
 template <class T>
-int16_t AudioFile<T>::twoBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness)
+int16_t AudioFile<T>::twoBytesToInt (const uint8_t* source, size_t startIndex, Endianness endianness)
 {
     int16_t result;
     
@@ -838,65 +883,535 @@ int16_t AudioFile<T>::twoBytesToInt (std::vector<uint8_t>& source, int startInde
 
 //=============================================================
 template <class T>
-int AudioFile<T>::getIndexOfString (std::vector<uint8_t>& source, std::string stringToSearchFor)
+AudioFileReader<T>::AudioFileReader()
+{
+    dataStartIndex = 0;
+    numSamplesPerChannel = 0;
+    position = 0;
+    numChannels = 0;
+    sampleRate = 44100;
+    bitDepth = 16;
+}
+
+//=============================================================
+template <class T>
+bool AudioFileReader<T>::open (std::string filePath)
+{
+    close();
+    
+    file.open (filePath, std::ios::binary);
+    
+    // check the file exists
+    if (! file.good())
+    {
+        std::cout << "ERROR: File doesn't exist or otherwise can't load file" << std::endl;
+        std::cout << filePath << std::endl;
+        return false;
+    }
+    
+    if (! readHeader())
+    {
+        close();
+        return false;
+    }
+    
+    return true;
+}
+
+//=============================================================
+template <class T>
+void AudioFileReader<T>::close()
+{
+    if (file.is_open())
+        file.close();
+    
+    file.clear();
+    chunkIndex.clear();
+    numSamplesPerChannel = 0;
+    position = 0;
+}
+
+//=============================================================
+template <class T>
+bool AudioFileReader<T>::isOpen() const
 {
-    int index = -1;
-    int stringLength = (int)stringToSearchFor.length();
+    return file.is_open();
+}
+
+//=============================================================
+template <class T>
+bool AudioFileReader<T>::readHeader()
+{
+    // -----------------------------------------------------------
+    // walk the chunks, reading only their headers, to find the format and data chunks
+    const AudioChunk* formatChunk = nullptr;
+    const AudioChunk* dataChunk = nullptr;
+    
+    AudioChunkIndex::Container container = AudioChunkIndex::Container::Unknown;
     
-    for (int i = 0; i < source.size() - stringLength;i++)
+    if (chunkIndex.build (file))
+        container = chunkIndex.getContainer();
+    
+    if ((container == AudioChunkIndex::Container::Riff || container == AudioChunkIndex::Container::Rf64) && chunkIndex.getFormType() == "WAVE")
     {
-        std::string section (source.begin() + i, source.begin() + i + stringLength);
+        formatChunk = chunkIndex.find ("fmt ");
+        dataChunk = chunkIndex.find ("data");
+    }
+    
+    uint8_t f[16];
+    
+    if (formatChunk == nullptr || dataChunk == nullptr || chunkIndex.getSizeInFile (*formatChunk) < 16
+        || ! file.seekg ((std::streamoff) formatChunk->offset) || ! file.read ((char*)f, 16))
+    {
+        file.clear();
+        std::cout << "ERROR: this doesn't seem to be a valid .WAV file" << std::endl;
+        return false;
+    }
+    
+    // -----------------------------------------------------------
+    // FORMAT CHUNK
+    int16_t audioFormat = (f[1] << 8) | f[0];
+    numChannels = (f[3] << 8) | f[2];
+    sampleRate = (uint32_t)((f[7] << 24) | (f[6] << 16) | (f[5] << 8) | f[4]);
+    int32_t numBytesPerSecond = (f[11] << 24) | (f[10] << 16) | (f[9] << 8) | f[8];
+    int16_t numBytesPerBlock = (f[13] << 8) | f[12];
+    bitDepth = (int16_t)((f[15] << 8) | f[14]);
+    dataStartIndex = (std::streamoff) dataChunk->offset;
+    
+    // check that the audio format is PCM
+    if (audioFormat != 1)
+    {
+        std::cout << "ERROR: this is a compressed .WAV file and this library does not support decoding them at present" << std::endl;
+        return false;
+    }
+    
+    // check the number of channels is mono or stereo
+    if (numChannels < 1 || numChannels > 2)
+    {
+        std::cout << "ERROR: this WAV file seems to be neither mono nor stereo (perhaps multi-track, or corrupted?)" << std::endl;
+        return false;
+    }
+    
+    // check bit depth is either 8, 16 or 24 bit
+    if (bitDepth != 8 && bitDepth != 16 && bitDepth != 24)
+    {
+        std::cout << "ERROR: this file has a bit depth that is not 8, 16 or 24 bits" << std::endl;
+        return false;
+    }
+    
+    // check header data is consistent
+    if ((numBytesPerSecond != (numChannels * sampleRate * bitDepth) / 8) || (numBytesPerBlock != (numChannels * bitDepth / 8)))
+    {
+        std::cout << "ERROR: the header data in this WAV file seems to be inconsistent" << std::endl;
+        return false;
+    }
+    
+    // don't read past the end of the file if the data chunk claims more than is there
+    numSamplesPerChannel = (int64_t)(chunkIndex.getSizeInFile (*dataChunk) / numBytesPerBlock);
+    
+    return seek (0);
+}
+
+//=============================================================
+template <class T>
+int AudioFileReader<T>::read (AudioBuffer& block, int maxNumFrames)
+{
+    int numFrames = (int) std::max ((int64_t)0, std::min ((int64_t)maxNumFrames, numSamplesPerChannel - position));
+    
+    block.resize (numChannels);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+        block[channel].resize (numFrames);
+    
+    if (numFrames == 0)
+        return 0;
+    
+    std::vector<T*> channels (numChannels);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+        channels[channel] = block[channel].data();
+    
+    int numFramesRead = readBlock (channels.data(), numFrames);
+    
+    if (numFramesRead < numFrames)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+            block[channel].resize (numFramesRead);
+    }
+    
+    return numFramesRead;
+}
+
+//=============================================================
+template <class T>
+int64_t AudioFileReader<T>::read (AudioBufferView<T> destination)
+{
+    if (destination.getNumChannels() < numChannels)
+        return 0;
+    
+    int64_t numFrames = std::max ((int64_t)0, std::min (destination.getNumFrames(), numSamplesPerChannel - position));
+    
+    // a few thousand frames at a time, so the byte buffer stays small however big the view is
+    const int64_t maxFramesPerBlock = 4096;
+    std::vector<T*> channels (numChannels);
+    int64_t numFramesRead = 0;
+    
+    while (numFramesRead < numFrames)
+    {
+        int numBlockFrames = (int) std::min (maxFramesPerBlock, numFrames - numFramesRead);
         
-        if (section == stringToSearchFor)
-        {
-            index = i;
+        for (int channel = 0; channel < numChannels; channel++)
+            channels[channel] = destination[channel].data() + numFramesRead;
+        
+        int numBlockFramesRead = readBlock (channels.data(), numBlockFrames);
+        numFramesRead += numBlockFramesRead;
+        
+        if (numBlockFramesRead < numBlockFrames)
             break;
-        }
     }
     
-    return index;
+    return numFramesRead;
+}
+
+//=============================================================
+template <class T>
+int AudioFileReader<T>::readBlock (T* const* channels, int numFrames)
+{
+    int numBytesPerBlock = numChannels * (bitDepth / 8);
+    
+    blockData.resize ((size_t)numFrames * numBytesPerBlock);
+    
+    if (! file.read ((char*)blockData.data(), (std::streamsize)blockData.size()))
+    {
+        std::cout << "ERROR: couldn't read from the file" << std::endl;
+        numFrames = (int)(file.gcount() / numBytesPerBlock);
+        file.clear();
+    }
+    
+    PcmKernels::decode (blockData.data(), PcmKernels::getFormat (bitDepth, false), numChannels, numFrames, channels);
+    
+    position += numFrames;
+    
+    return numFrames;
+}
+
+//=============================================================
+template <class T>
+bool AudioFileReader<T>::seek (int64_t frame)
+{
+    if (! file.is_open() || frame < 0 || frame > numSamplesPerChannel)
+        return false;
+    
+    file.seekg (dataStartIndex + (std::streamoff)frame * numChannels * (bitDepth / 8));
+    position = frame;
+    
+    return true;
+}
+
+//=============================================================
+template <class T>
+int64_t AudioFileReader<T>::getPosition() const
+{
+    return position;
+}
+
+//=============================================================
+template <class T>
+uint32_t AudioFileReader<T>::getSampleRate() const
+{
+    return sampleRate;
+}
+
+//=============================================================
+template <class T>
+int AudioFileReader<T>::getNumChannels() const
+{
+    return numChannels;
+}
+
+//=============================================================
+template <class T>
+int AudioFileReader<T>::getBitDepth() const
+{
+    return bitDepth;
+}
+
+//=============================================================
+template <class T>
+int64_t AudioFileReader<T>::getNumSamplesPerChannel() const
+{
+    return numSamplesPerChannel;
+}
+
+//=============================================================
+template <class T>
+const AudioChunkIndex& AudioFileReader<T>::getChunkIndex() const
+{
+    return chunkIndex;
+}
+
+//=============================================================
+template <class T>
+AudioFileWriter<T>::AudioFileWriter()
+{
+    numChannels = 0;
+    sampleRate = 44100;
+    bitDepth = 16;
+    numSamplesWritten = 0;
+    alwaysRf64 = false;
+}
+
+//=============================================================
+template <class T>
+AudioFileWriter<T>::~AudioFileWriter()
+{
+    close();
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::open (std::string filePath, int newNumChannels, uint32_t newSampleRate, int newBitDepth)
+{
+    close();
+    
+    if (newNumChannels <= 0 || (newBitDepth != 8 && newBitDepth != 16 && newBitDepth != 24))
+    {
+        assert (false && "Trying to write a file with unsupported channels or bit depth");
+        return false;
+    }
+    
+    numChannels = newNumChannels;
+    sampleRate = newSampleRate;
+    bitDepth = newBitDepth;
+    numSamplesWritten = 0;
+    
+    file.open (filePath, std::ios::binary);
+    
+    if (! file.is_open())
+    {
+        std::cout << "ERROR: couldn't save file to " << filePath << std::endl;
+        return false;
+    }
+    
+    blockData.clear();
+    
+    // -----------------------------------------------------------
+    // HEADER CHUNK, the size is filled in by close()
+    blockData.insert (blockData.end(), {'R', 'I', 'F', 'F'});
+    addInt32ToBlockData (0);
+    blockData.insert (blockData.end(), {'W', 'A', 'V', 'E'});
+    
+    // -----------------------------------------------------------
+    // JUNK CHUNK, which close() turns into a ds64 chunk if the file outgrows 4GB
+    blockData.insert (blockData.end(), {'J', 'U', 'N', 'K'});
+    addInt32ToBlockData (28);
+    blockData.insert (blockData.end(), 28, 0);
+    
+    // -----------------------------------------------------------
+    // FORMAT CHUNK
+    blockData.insert (blockData.end(), {'f', 'm', 't', ' '});
+    addInt32ToBlockData (16); // format chunk size (16 for PCM)
+    addInt16ToBlockData (1); // audio format = 1
+    addInt16ToBlockData ((int16_t)numChannels); // num channels
+    addInt32ToBlockData ((int32_t)sampleRate); // sample rate
+    addInt32ToBlockData ((int32_t)((numChannels * sampleRate * bitDepth) / 8)); // num bytes per second
+    addInt16ToBlockData ((int16_t)(numChannels * (bitDepth / 8))); // num bytes per block
+    addInt16ToBlockData ((int16_t)bitDepth);
+    
+    // -----------------------------------------------------------
+    // DATA CHUNK, the size is filled in by close()
+    blockData.insert (blockData.end(), {'d', 'a', 't', 'a'});
+    addInt32ToBlockData (0);
+    
+    return (bool) file.write ((const char*)blockData.data(), (std::streamsize)blockData.size());
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::write (const AudioBuffer& buffer, int64_t startFrame, int64_t numFrames)
+{
+    if ((int)buffer.size() < numChannels)
+        return false;
+    
+    std::vector<const T*> channels (numChannels);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        assert (startFrame >= 0 && startFrame + numFrames <= (int64_t)buffer[channel].size());
+        channels[channel] = buffer[channel].data() + startFrame;
+    }
+    
+    return writeChannels (channels.data(), numFrames);
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::write (const AudioBuffer& buffer)
+{
+    int64_t numFrames = buffer.size() > 0 ? (int64_t)buffer[0].size() : 0;
+    return write (buffer, 0, numFrames);
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::write (AudioBufferView<const T> frames)
+{
+    if (frames.getNumChannels() < numChannels)
+        return false;
+    
+    std::vector<const T*> channels (numChannels);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+        channels[channel] = frames[channel].data();
+    
+    return writeChannels (channels.data(), frames.getNumFrames());
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::writeChannels (const T* const* channels, int64_t numFrames)
+{
+    if (! file.is_open())
+        return false;
+    
+    // encode and write a few thousand frames at a time so the byte buffer stays small
+    const int64_t maxFramesPerBlock = 4096;
+    std::vector<const T*> blockChannels (numChannels);
+    
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += maxFramesPerBlock)
+    {
+        int numBlockFrames = (int) std::min (maxFramesPerBlock, numFrames - blockStart);
+        
+        for (int channel = 0; channel < numChannels; channel++)
+            blockChannels[channel] = channels[channel] + blockStart;
+        
+        blockData.resize ((size_t)numBlockFrames * numChannels * (bitDepth / 8));
+        PcmKernels::encode (blockChannels.data(), PcmKernels::getFormat (bitDepth, false), numChannels, numBlockFrames, blockData.data());
+        
+        if (! file.write ((const char*)blockData.data(), (std::streamsize)blockData.size()))
+            return false;
+        
+        numSamplesWritten += numBlockFrames;
+    }
+    
+    return true;
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::close()
+{
+    if (! file.is_open())
+        return false;
+    
+    uint64_t dataChunkSize = (uint64_t)numSamplesWritten * (numChannels * bitDepth / 8);
+    
+    // chunks are padded to an even number of bytes
+    if (dataChunkSize & 1)
+        file.put (0);
+    
+    // The file size in bytes is the header chunk size (4, not counting RIFF and WAVE) + the JUNK
+    // chunk size (36) + the format chunk size (24) + the metadata part of the data chunk plus the
+    // actual data chunk size
+    uint64_t fileSizeInBytes = 4 + 36 + 24 + 8 + dataChunkSize + (dataChunkSize & 1);
+    
+    if (fileSizeInBytes <= 0xFFFFFFFF && ! alwaysRf64)
+    {
+        blockData.clear();
+        addInt32ToBlockData ((int32_t)fileSizeInBytes);
+        file.seekp (4);
+        file.write ((const char*)blockData.data(), 4);
+        
+        blockData.clear();
+        addInt32ToBlockData ((int32_t)dataChunkSize);
+        file.seekp (76);
+        file.write ((const char*)blockData.data(), 4);
+    }
+    else
+    {
+        // too big for RIFF, so the 32-bit sizes are set to -1 and the real ones go in a ds64 chunk
+        blockData.clear();
+        blockData.insert (blockData.end(), {'R', 'F', '6', '4'});
+        addInt32ToBlockData (-1);
+        blockData.insert (blockData.end(), {'W', 'A', 'V', 'E'});
+        blockData.insert (blockData.end(), {'d', 's', '6', '4'});
+        addInt32ToBlockData (28);
+        addInt64ToBlockData (fileSizeInBytes); // riff size
+        addInt64ToBlockData (dataChunkSize); // data size
+        addInt64ToBlockData ((uint64_t)numSamplesWritten); // sample count
+        addInt32ToBlockData (0); // table length
+        file.seekp (0);
+        file.write ((const char*)blockData.data(), (std::streamsize)blockData.size());
+        
+        blockData.clear();
+        addInt32ToBlockData (-1);
+        file.seekp (76);
+        file.write ((const char*)blockData.data(), 4);
+    }
+    
+    bool succeeded = file.good();
+    file.close();
+    
+    return succeeded;
+}
+
+//=============================================================
+template <class T>
+bool AudioFileWriter<T>::isOpen() const
+{
+    return file.is_open();
 }
 
 //=============================================================
 template <class T>
-T AudioFile<T>::sixteenBitIntToSample (int16_t sample)
+void AudioFileWriter<T>::setAlwaysRf64 (bool shouldAlwaysBeRf64)
 {
-    return static_cast<T> (sample) / static_cast<T> (32768.);
+    alwaysRf64 = shouldAlwaysBeRf64;
 }
 
 //=============================================================
 template <class T>
-int16_t AudioFile<T>::sampleToSixteenBitInt (T sample)
+int64_t AudioFileWriter<T>::getNumSamplesWritten() const
 {
-    sample = clamp (sample, -1., 1.);
-    return static_cast<int16_t> (sample * 32767.);
+    return numSamplesWritten;
 }
 
 //=============================================================
 template <class T>
-uint8_t AudioFile<T>::sampleToSingleByte (T sample)
+void AudioFileWriter<T>::addInt64ToBlockData (uint64_t i)
 {
-    sample = clamp (sample, -1., 1.);
-    sample = (sample + 1.) / 2.;
-    return static_cast<uint8_t> (sample * 255.);
+    addInt32ToBlockData ((int32_t)(i & 0xFFFFFFFF));
+    addInt32ToBlockData ((int32_t)(i >> 32));
 }
 
 //=============================================================
 template <class T>
-T AudioFile<T>::singleByteToSample (uint8_t sample)
+void AudioFileWriter<T>::addInt32ToBlockData (int32_t i)
 {
-    return static_cast<T> (sample - 128) / static_cast<T> (128.);
+    blockData.push_back (i & 0xFF);
+    blockData.push_back ((i >> 8) & 0xFF);
+    blockData.push_back ((i >> 16) & 0xFF);
+    blockData.push_back ((i >> 24) & 0xFF);
 }
 
 //=============================================================
 template <class T>
-T AudioFile<T>::clamp (T value, T minValue, T maxValue)
+void AudioFileWriter<T>::addInt16ToBlockData (int16_t i)
 {
-    value = std::min (value, maxValue);
-    value = std::max (value, minValue);
-    return value;
+    blockData.push_back (i & 0xFF);
+    blockData.push_back ((i >> 8) & 0xFF);
 }
 
 //===========================================================
 template class AudioFile<float>;
 template class AudioFile<double>;
+template class AudioFileReader<float>;
+template class AudioFileReader<double>;
+template class AudioFileWriter<float>;
+template class AudioFileWriter<double>;
+template class AudioFile<int16_t>;
+template class AudioFile<int32_t>;
+template class AudioFileReader<int16_t>;
+template class AudioFileReader<int32_t>;
+template class AudioFileWriter<int16_t>;
+template class AudioFileWriter<int32_t>;
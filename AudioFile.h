@@ -24,9 +24,18 @@
 #define _AS_AudioFile_h
 
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <assert.h>
 #include <string>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include "PlanarAudioBuffer.h"
+#include "AudioChunkIndex.h"
 
 
 //=============================================================
@@ -42,6 +51,57 @@ enum class AudioFileFormat
     Aiff
 };
 
+//=============================================================
+/** The ways in which load() can get the bytes of a file into memory
+ * before decoding. MemoryMapped decodes straight from the mapped pages
+ * of the file and falls back to ReadIntoMemory where mapping isn't
+ * available. HeaderOnly decodes nothing: it reads the format and finds
+ * the chunks of a .wav file, then keeps the file open so that ranges of
+ * frames can be decoded on demand with readFrames().
+ */
+enum class AudioFileLoadMode
+{
+    ReadIntoMemory,
+    MemoryMapped,
+    HeaderOnly
+};
+
+//=============================================================
+/** How the samples of an AudioFile<T> relate to amplitudes in the range -1 to 1.
+ * float and double samples are those amplitudes. int16_t and int32_t samples
+ * are left justified, so the full range of the type is -1 to 1 whatever the
+ * bit depth of the file, and 16-bit files are held exactly.
+ */
+template <class T, bool isInteger = std::is_integral<T>::value>
+struct AudioSampleTraits
+{
+    /** @Returns a sample as an amplitude */
+    static double toAmplitude (T sample) { return (double) sample; }
+    
+    /** @Returns the largest sample no greater than an amplitude, so that comparing samples
+     * with it gives the same answers as comparing their amplitudes with the amplitude
+     */
+    static T fromAmplitude (double amplitude) { return (T) amplitude; }
+};
+
+template <class T>
+struct AudioSampleTraits<T, true>
+{
+    static double fullScale() { return std::ldexp (1.0, 8 * (int) sizeof (T) - 1); }
+    
+    static double toAmplitude (T sample) { return (double) sample / fullScale(); }
+    
+    static T fromAmplitude (double amplitude)
+    {
+        double sample = std::floor (amplitude * fullScale());
+        sample = std::min (sample, (double) std::numeric_limits<T>::max());
+        return (T) std::max (sample, (double) std::numeric_limits<T>::lowest());
+    }
+};
+
+//=============================================================
+template <class T> class AudioFileReader;
+
 //=============================================================
 template <class T>
 class AudioFile
@@ -59,7 +119,7 @@ public:
     /** Loads an audio file from a given file path.
      * @Returns true if the file was successfully loaded
      */
-    bool load (std::string filePath);
+    bool load (std::string filePath, AudioFileLoadMode loadMode = AudioFileLoadMode::MemoryMapped);
     
     /** Saves an audio file to a given file path.
      * @Returns true if the file was successfully saved
@@ -83,7 +143,7 @@ public:
     int getBitDepth() const;
     
     /** @Returns the number of samples per channel */
-    int getNumSamplesPerChannel() const;
+    int64_t getNumSamplesPerChannel() const;
     
     /** @Returns the length in seconds of the audio file based on the number of samples and sample rate */
     double getLengthInSeconds() const;
@@ -91,6 +151,26 @@ public:
     /** Prints a summary of the audio file to the console */
     void printSummary() const;
     
+    /** @Returns the chunks of the file most recently loaded, e.g. to find its "LIST" metadata
+     * or where its audio data starts
+     */
+    const AudioChunkIndex& getChunkIndex() const;
+    
+    /** @Returns true if the file was loaded with AudioFileLoadMode::HeaderOnly, so samples is
+     * empty and its frames are read with readFrames()
+     */
+    bool isHeaderOnly() const;
+    
+    //=============================================================
+    /** Decodes numFrames frames, starting at startFrame, into destination, which must have at
+     * least getNumChannels() channels. If the file was loaded with AudioFileLoadMode::HeaderOnly
+     * only those frames are read from disk, otherwise they are copied from samples. Copies of a
+     * header-only AudioFile can read frames at the same time, from any thread.
+     * @Returns the number of frames read, which is less than numFrames if the range runs past the
+     * end of the audio or of destination
+     */
+    int64_t readFrames (int64_t startFrame, int64_t numFrames, AudioBufferView<T> destination);
+    
     //=============================================================
     
     /** Set the audio buffer for this AudioFile by copying samples from another buffer.
@@ -100,13 +180,14 @@ public:
     
     /** Sets the audio buffer to a given number of channels and number of samples per channel. This will try to preserve
      * the existing audio, adding zeros to any new channels or new samples in a given channel.
+     * Changing the buffer of a header-only file closes the file, leaving only what is in the buffer.
      */
-    void setAudioBufferSize (int numChannels, int numSamples);
+    void setAudioBufferSize (int numChannels, int64_t numSamples);
     
     /** Sets the number of samples per channel in the audio buffer. This will try to preserve
      * the existing audio, adding zeros to new samples in a given channel if the number of samples is increased.
      */
-    void setNumSamplesPerChannel (int numSamples);
+    void setNumSamplesPerChannel (int64_t numSamples);
     
     /** Sets the number of channels. New channels will have the correct number of samples and be initialised to zero */
     void setNumChannels (int numChannels);
@@ -118,12 +199,15 @@ public:
     void setSampleRate (uint32_t newSampleRate);
     
     //=============================================================
-    /** A vector of vectors holding the audio samples for the AudioFile. You can 
+    /** A planar buffer holding the audio samples for the AudioFile. You can 
      * access the samples by channel and then by sample index, i.e:
      *
      *      samples[channel][sampleIndex]
+     *
+     * and take views of ranges of frames with samples.getFrames() without copying them.
+     * For integer types, the samples are left justified as described by AudioSampleTraits.
      */
-    AudioBuffer samples;
+    PlanarAudioBuffer<T> samples;
     
 private:
     
@@ -135,9 +219,12 @@ private:
     };
     
     //=============================================================
-    AudioFileFormat determineAudioFileFormat (std::vector<uint8_t>& fileData);
-    bool decodeWaveFile (std::vector<uint8_t>& fileData);
-    bool decodeAiffFile (std::vector<uint8_t>& fileData);
+    bool openHeaderOnly (std::string filePath);
+    bool decodeFileData (const uint8_t* fileData, size_t fileSize);
+    AudioFileFormat determineAudioFileFormat (const uint8_t* fileData, size_t fileSize);
+    bool decodeWaveFile (const uint8_t* fileData);
+    bool decodeAiffFile (const uint8_t* fileData, size_t fileSize);
+    void decodeSamples (const uint8_t* sampleData, int64_t numFrames, bool isBigEndian);
     
     //=============================================================
     bool saveToWaveFile (std::string filePath);
@@ -147,22 +234,13 @@ private:
     void clearAudioBuffer();
     
     //=============================================================
-    int32_t fourBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness = Endianness::LittleEndian);
-    int16_t twoBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness = Endianness::LittleEndian);
-    int getIndexOfString (std::vector<uint8_t>& source, std::string s);
+    int32_t fourBytesToInt (const uint8_t* source, size_t startIndex, Endianness endianness = Endianness::LittleEndian);
+    int16_t twoBytesToInt (const uint8_t* source, size_t startIndex, Endianness endianness = Endianness::LittleEndian);
     
     //=============================================================
-    T sixteenBitIntToSample (int16_t sample);
-    int16_t sampleToSixteenBitInt (T sample);
-    
-    //=============================================================
-    uint8_t sampleToSingleByte (T sample);
-    T singleByteToSample (uint8_t sample);
-    
-    uint32_t getAiffSampleRate (std::vector<uint8_t>& fileData, int sampleRateStartIndex);
-    bool tenByteMatch (std::vector<uint8_t>& v1, int startIndex1, std::vector<uint8_t>& v2, int startIndex2);
+    uint32_t getAiffSampleRate (const uint8_t* fileData, size_t sampleRateStartIndex);
+    bool tenByteMatch (const uint8_t* v1, size_t startIndex1, const std::vector<uint8_t>& v2, int startIndex2);
     void addSampleRateToAiffData (std::vector<uint8_t>& fileData, uint32_t sampleRate);
-    T clamp (T v1, T minValue, T maxValue);
     
     //=============================================================
     void addStringToFileData (std::vector<uint8_t>& fileData, std::string s);
@@ -174,8 +252,181 @@ private:
     
     //=============================================================
     AudioFileFormat audioFileFormat;
+    AudioChunkIndex chunkIndex;
+    uint32_t sampleRate;
+    int bitDepth;
+    
+    // the open file of a header-only AudioFile, which copies of it share. Each readFrames()
+    // holds the lock from its seek to the end of its read, so copies never move each other's
+    // read position, even from different threads.
+    std::shared_ptr<AudioFileReader<T>> headerOnlyReader;
+    std::shared_ptr<std::mutex> headerOnlyReaderLock;
+};
+
+//=============================================================
+/** Reads the audio data of a .wav file a block of frames at a time, so
+ * that files can be processed without holding the whole of their decoded
+ * audio in memory. RF64 files over 4GB are read too.
+ */
+template <class T>
+class AudioFileReader
+{
+public:
+    
+    //=============================================================
+    typedef typename AudioFile<T>::AudioBuffer AudioBuffer;
+    
+    //=============================================================
+    /** Constructor */
+    AudioFileReader();
+    
+    //=============================================================
+    /** Opens a .wav file and reads its header, leaving the reader at the first frame.
+     * @Returns true if the file was successfully opened
+     */
+    bool open (std::string filePath);
+    
+    /** Closes the file, if one is open */
+    void close();
+    
+    /** @Returns true if a file is open */
+    bool isOpen() const;
+    
+    //=============================================================
+    /** Reads up to maxNumFrames frames from the current position into block, resizing
+     * each of its channels to the number of frames read.
+     * @Returns the number of frames read, which is 0 once the end of the file is reached
+     */
+    int read (AudioBuffer& block, int maxNumFrames);
+    
+    /** Reads frames from the current position until destination is full or the end of the
+     * file is reached, decoding straight into the view without resizing anything.
+     * @Returns the number of frames read
+     */
+    int64_t read (AudioBufferView<T> destination);
+    
+    /** Moves the read position to a given frame.
+     * @Returns true if the frame is within the file
+     */
+    bool seek (int64_t frame);
+    
+    /** @Returns the frame that the next read will start from */
+    int64_t getPosition() const;
+    
+    //=============================================================
+    /** @Returns the sample rate */
+    uint32_t getSampleRate() const;
+    
+    /** @Returns the number of audio channels in the file */
+    int getNumChannels() const;
+    
+    /** @Returns the bit depth of each sample */
+    int getBitDepth() const;
+    
+    /** @Returns the number of samples per channel */
+    int64_t getNumSamplesPerChannel() const;
+    
+    /** @Returns the chunks of the open file */
+    const AudioChunkIndex& getChunkIndex() const;
+    
+private:
+    
+    //=============================================================
+    bool readHeader();
+    int readBlock (T* const* channels, int numFrames);
+    
+    //=============================================================
+    std::ifstream file;
+    AudioChunkIndex chunkIndex;
+    std::vector<uint8_t> blockData;
+    std::streamoff dataStartIndex;
+    int64_t numSamplesPerChannel;
+    int64_t position;
+    int numChannels;
+    uint32_t sampleRate;
+    int bitDepth;
+};
+
+//=============================================================
+/** Writes a .wav file a block of frames at a time. A header with placeholder
+ * sizes is written when the file is opened and the sizes are filled in when
+ * it is closed, so audio can be streamed to disk as it is produced.
+ *
+ * The header reserves room for a "ds64" chunk in a "JUNK" chunk, which other
+ * readers skip. If more than 4GB was written, close() turns the file into RF64
+ * by filling in the ds64 chunk, so recordings are limited only by the disk.
+ */
+template <class T>
+class AudioFileWriter
+{
+public:
+    
+    //=============================================================
+    typedef typename AudioFile<T>::AudioBuffer AudioBuffer;
+    
+    //=============================================================
+    /** Constructor */
+    AudioFileWriter();
+    
+    /** Destructor. Closes the file if it is still open */
+    ~AudioFileWriter();
+    
+    //=============================================================
+    /** Creates a .wav file with the given format and writes its header.
+     * @Returns true if the file was successfully created
+     */
+    bool open (std::string filePath, int numChannels, uint32_t sampleRate, int bitDepth);
+    
+    /** Appends numFrames frames of buffer, starting at startFrame, to the file.
+     * @Returns true if the frames were successfully written
+     */
+    bool write (const AudioBuffer& buffer, int64_t startFrame, int64_t numFrames);
+    
+    /** Appends every frame of buffer to the file.
+     * @Returns true if the frames were successfully written
+     */
+    bool write (const AudioBuffer& buffer);
+    
+    /** Appends every frame of a view, e.g. of part of AudioFile<T>::samples, to the file.
+     * @Returns true if the frames were successfully written
+     */
+    bool write (AudioBufferView<const T> frames);
+    
+    /** Fills in the sizes in the file's header, switching it to RF64 if they don't fit
+     * in 32 bits, and closes it.
+     * @Returns true if the file was successfully finished
+     */
+    bool close();
+    
+    /** @Returns true if a file is open */
+    bool isOpen() const;
+    
+    /** Makes close() write RF64 even if the file would fit in a plain RIFF, for tools
+     * that want RF64 whatever the length
+     */
+    void setAlwaysRf64 (bool shouldAlwaysBeRf64);
+    
+    /** @Returns the number of samples per channel written so far */
+    int64_t getNumSamplesWritten() const;
+    
+private:
+    
+    //=============================================================
+    bool writeChannels (const T* const* channels, int64_t numFrames);
+    
+    //=============================================================
+    void addInt64ToBlockData (uint64_t i);
+    void addInt32ToBlockData (int32_t i);
+    void addInt16ToBlockData (int16_t i);
+    
+    //=============================================================
+    std::ofstream file;
+    std::vector<uint8_t> blockData;
+    int numChannels;
     uint32_t sampleRate;
     int bitDepth;
+    int64_t numSamplesWritten;
+    bool alwaysRf64;
 };
 
 #endif /* AudioFile_h */
@@ -0,0 +1,139 @@
+//=======================================================================
+/** @file AudioRingBuffer.h
+ *
+ * A fixed-capacity, multi-channel ring buffer of samples for passing audio
+ * from one producer to one consumer. All memory is allocated up front, so
+ * writing and reading never allocate, and the read and write positions are
+ * atomics so the producer and consumer can run on different threads without
+ * a lock.
+ */
+//=======================================================================
+
+#ifndef _AS_AudioRingBuffer_h
+#define _AS_AudioRingBuffer_h
+
+#include <atomic>
+#include <algorithm>
+#include "PlanarAudioBuffer.h"
+
+//=============================================================
+template <class T>
+class AudioRingBuffer
+{
+public:
+
+    //=============================================================
+    /** Constructs a ring buffer with no capacity. Call setSize() before using it. */
+    AudioRingBuffer() : capacity (0), mask (0), readCount (0), writeCount (0) {}
+
+    /** Constructs a ring buffer that can hold at least minCapacity frames of numChannels channels */
+    AudioRingBuffer (int numChannels, int minCapacity) : AudioRingBuffer()
+    {
+        setSize (numChannels, minCapacity);
+    }
+
+    //=============================================================
+    /** Allocates room for at least minCapacity frames of numChannels channels, rounded up to
+     * a power of two, and empties the buffer. This must not be called while the buffer is
+     * being read or written.
+     */
+    void setSize (int numChannels, int minCapacity)
+    {
+        capacity = 1;
+
+        while (capacity < minCapacity)
+            capacity *= 2;
+
+        mask = (uint32_t)capacity - 1;
+        storage.clear();
+        storage.setSize (numChannels, capacity);
+        readCount.store (0);
+        writeCount.store (0);
+    }
+
+    /** @Returns the number of channels */
+    int getNumChannels() const { return storage.getNumChannels(); }
+
+    /** @Returns the number of frames the buffer can hold */
+    int getCapacity() const { return storage.getNumChannels() > 0 ? capacity : 0; }
+
+    //=============================================================
+    /** For the producer. @Returns the number of frames that can be written */
+    int getFreeSpace() const
+    {
+        return getCapacity() - (int)(writeCount.load (std::memory_order_relaxed) - readCount.load (std::memory_order_acquire));
+    }
+
+    /** For the producer. Appends up to numFrames frames, taking one sample per frame from each of
+     * the arrays in channels.
+     * @Returns the number of frames written, which is less than numFrames if the buffer fills up
+     */
+    int write (const T* const* channels, int numFrames)
+    {
+        uint32_t start = writeCount.load (std::memory_order_relaxed);
+        numFrames = std::max (0, std::min (numFrames, getFreeSpace()));
+
+        int startIndex = (int)(start & mask);
+        int numFramesBeforeWrap = std::min (numFrames, capacity - startIndex);
+
+        for (int channel = 0; channel < getNumChannels(); channel++)
+        {
+            T* destination = storage[channel].data();
+            std::copy (channels[channel], channels[channel] + numFramesBeforeWrap, destination + startIndex);
+            std::copy (channels[channel] + numFramesBeforeWrap, channels[channel] + numFrames, destination);
+        }
+
+        writeCount.store (start + (uint32_t)numFrames, std::memory_order_release);
+        return numFrames;
+    }
+
+    //=============================================================
+    /** For the consumer. @Returns the number of frames that have been written and not yet discarded */
+    int getNumReady() const
+    {
+        return (int)(writeCount.load (std::memory_order_acquire) - readCount.load (std::memory_order_relaxed));
+    }
+
+    /** For the consumer. @Returns a sample of the frame frameIndex frames after the oldest ready frame */
+    T getSample (int channel, int frameIndex) const
+    {
+        assert (frameIndex >= 0 && frameIndex < getNumReady());
+        return storage[channel][(int)((readCount.load (std::memory_order_relaxed) + (uint32_t)frameIndex) & mask)];
+    }
+
+    /** For the consumer. Gets views of numFrames ready frames, starting startFrame frames after
+     * the oldest one. The frames may wrap around the end of the buffer, so they come back as
+     * two views, the second of which is empty if they don't.
+     */
+    void getFrames (int startFrame, int numFrames, AudioBufferView<const T>& first, AudioBufferView<const T>& second) const
+    {
+        assert (startFrame >= 0 && numFrames >= 0 && startFrame + numFrames <= getNumReady());
+
+        int startIndex = (int)((readCount.load (std::memory_order_relaxed) + (uint32_t)startFrame) & mask);
+        int numFramesBeforeWrap = std::min (numFrames, capacity - startIndex);
+
+        first = storage.getFrames (startIndex, numFramesBeforeWrap);
+        second = storage.getFrames (0, numFrames - numFramesBeforeWrap);
+    }
+
+    /** For the consumer. Frees the numFrames oldest ready frames for the producer to reuse */
+    void discard (int numFrames)
+    {
+        assert (numFrames >= 0 && numFrames <= getNumReady());
+        readCount.store (readCount.load (std::memory_order_relaxed) + (uint32_t)numFrames, std::memory_order_release);
+    }
+
+private:
+
+    //=============================================================
+    PlanarAudioBuffer<T> storage;
+    int capacity;
+    uint32_t mask;
+
+    // These count every frame ever read and written, wrapping around at 2^32,
+    // so their difference is the number of ready frames
+    std::atomic<uint32_t> readCount;
+    std::atomic<uint32_t> writeCount;
+};
+
+#endif /* _AS_AudioRingBuffer_h */
@@ -0,0 +1,131 @@
+#include "ExportPool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+
+#if defined (__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+template <class T>
+ExportPool<T>::ExportPool(int num_threads, int queue_capacity) : workers(std::max(num_threads, 1)), capacity(std::max(queue_capacity, 1)) {
+    for (Worker& worker : workers){
+        worker.thread = std::thread(&ExportPool<T>::run_worker, this, std::ref(worker));
+    }
+}
+
+template <class T>
+ExportPool<T>::~ExportPool(){
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (Worker& worker : workers){
+        worker.thread.join();
+    }
+}
+
+template <class T>
+void ExportPool<T>::submit(int key, ExportJob<T>&& job){
+    Worker& worker = workers[key % workers.size()];
+    std::unique_lock<std::mutex> lock(mutex);
+    if (worker.queue.size() >= capacity){
+        // Backpressure: the workers have fallen behind, so wait for room
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        space_available.wait(lock, [&]() { return worker.queue.size() < capacity; });
+        std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+        export_stats.times_blocked++;
+        export_stats.time_blocked_ms += waited.count();
+    }
+    worker.queue.push_back(std::move(job));
+    export_stats.jobs_submitted++;
+    export_stats.max_queue_depth = std::max(export_stats.max_queue_depth, (int) worker.queue.size());
+    lock.unlock();
+    work_available.notify_all();
+}
+
+template <class T>
+void ExportPool<T>::flush(){
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this]() {
+        for (Worker& worker : workers){
+            if (worker.busy || !worker.queue.empty()){
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+template <class T>
+ExportStats ExportPool<T>::stats(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return export_stats;
+}
+
+template <class T>
+void ExportPool<T>::run_worker(Worker& worker){
+#if defined (__linux__)
+    // Writing is never urgent, so on a busy machine the workers give way to the thread doing the splitting
+    setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), 19);
+#endif
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true){
+        work_available.wait(lock, [&]() { return stopping || !worker.queue.empty(); });
+        if (worker.queue.empty()){
+            return;
+        }
+        ExportJob<T> job = std::move(worker.queue.front());
+        worker.queue.pop_front();
+        worker.busy = true;
+        space_available.notify_all();
+
+        // Encoding and writing happen without the lock, so other workers and submit() carry on
+        lock.unlock();
+        write_job(worker, job);
+        lock.lock();
+
+        worker.busy = false;
+        export_stats.jobs_written++;
+        work_done.notify_all();
+    }
+}
+
+template <class T>
+void ExportPool<T>::write_job(Worker& worker, ExportJob<T>& job){
+    elma::TraceSpan span("ExportPool::write_job", "audio");
+    if (job.cancel){
+        if (worker.writer.isOpen()){
+            worker.writer.close();
+            std::remove(job.file_name.c_str());
+        }
+        return;
+    }
+    bool succeeded = true;
+    if (job.first){
+        succeeded = worker.writer.open(job.file_name, job.num_channels, job.sample_rate, job.bit_depth);
+    }
+    if (worker.writer.isOpen()){
+        succeeded = worker.writer.write(job.frames.getView()) && succeeded;
+    }
+    if (job.last){
+        succeeded = worker.writer.close() && succeeded;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (succeeded){
+            std::cout << "Exported " << job.file_name << std::endl;
+        } else {
+            export_stats.failed_files++;
+        }
+    }
+}
+
+template class ExportPool<float>;
+template class ExportPool<double>;
+template class ExportPool<int16_t>;
+template class ExportPool<int32_t>;
@@ -0,0 +1,103 @@
+#ifndef EXPORT_POOL_H
+#define EXPORT_POOL_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "AudioFile.h"
+
+//! A block of audio waiting to be written to a .wav file by an ExportPool.
+//! A sample can be written as one job, or as several jobs in order if it is spilled to disk as it's recorded.
+//! The frames are held as T, the sample type of the splitter that made the job.
+template <class T>
+struct ExportJob {
+    //! The .wav file the frames belong to.
+    std::string file_name;
+    int num_channels = 2;
+    uint32_t sample_rate = 44100;
+    int bit_depth = 16;
+    //! The frames to append to the file.
+    PlanarAudioBuffer<T> frames;
+    //! Is this the first block of the file? If so the file is created before the frames are written.
+    bool first = true;
+    //! Is this the last block of the file? If so the file is finished after the frames are written.
+    bool last = true;
+    //! Will the rest of the file never come? If so the part already written is deleted rather than finished.
+    bool cancel = false;
+};
+
+//! How an ExportPool has kept up with the jobs given to it.
+struct ExportStats {
+    //! The number of jobs submitted.
+    long jobs_submitted = 0;
+    //! The number of jobs written to disk.
+    long jobs_written = 0;
+    //! The number of files that couldn't be written.
+    long failed_files = 0;
+    //! The number of times submit() had to wait because a queue was full.
+    long times_blocked = 0;
+    //! The total time submit() spent waiting, in milliseconds.
+    double time_blocked_ms = 0;
+    //! The most jobs ever waiting in one queue.
+    int max_queue_depth = 0;
+};
+
+//! Encodes and writes .wav files on a fixed number of background threads, so that
+//! the thread submitting the audio never waits on the disk unless the pool falls behind.
+//! Each worker has a bounded queue. Jobs with the same key always go to the same worker,
+//! so the blocks of one file are written in the order they were submitted.
+//! On Linux the workers run at the lowest priority, so they don't hold up the submitting thread on a busy machine.
+//! It is instantiated for the same sample types as AudioFileWriter.
+template <class T>
+class ExportPool {
+
+    public:
+    //! \param num_threads The number of worker threads.
+    //! \param queue_capacity The number of jobs each worker can have waiting before submit() blocks.
+    ExportPool(int num_threads = 2, int queue_capacity = 8);
+
+    //! Writes every job still queued, then stops the workers.
+    ~ExportPool();
+
+    //! Queues a job for the worker chosen by key. Blocks while that worker's queue is full.
+    //! \param key Jobs for the same file must use the same key.
+    //! \param job The job, which is moved into the queue.
+    void submit(int key, ExportJob<T>&& job);
+
+    //! Waits until every job submitted so far has been written.
+    void flush();
+
+    //! \return A copy of the pool's statistics.
+    ExportStats stats();
+
+    private:
+    struct Worker {
+        std::thread thread;
+        std::deque<ExportJob<T>> queue;
+        //! Is the worker writing a job it has taken off its queue?
+        bool busy = false;
+        AudioFileWriter<T> writer;
+    };
+
+    //! The loop each worker thread runs.
+    void run_worker(Worker& worker);
+
+    //! Writes one job with a worker's writer.
+    void write_job(Worker& worker, ExportJob<T>& job);
+
+    std::vector<Worker> workers;
+    int capacity;
+    bool stopping = false;
+    ExportStats export_stats;
+
+    //! Guards the queues, the busy flags, stopping and the statistics.
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable space_available;
+    std::condition_variable work_done;
+};
+
+#endif
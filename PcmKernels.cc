@@ -0,0 +1,781 @@
+//=======================================================================
+/** @file PcmKernels.cc
+ *
+ * See PcmKernels.h. The SIMD kernels convert 4 or 8 samples at a time, so
+ * each call runs them over as many whole groups of frames as it can and
+ * then finishes the last few frames with the scalar kernel. Only mono and
+ * stereo data take the SIMD paths.
+ */
+//=======================================================================
+
+#include "PcmKernels.h"
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define PCM_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //=============================================================
+    // How to read one sample of each format, and the scale that takes it to the range -1 to 1
+    struct UInt8Sample
+    {
+        static const int numBytes = 1;
+        static int32_t read (const uint8_t* p) { return (int32_t)p[0] - 128; }
+        static double scale() { return 1. / 128.; }
+    };
+
+    struct Int8Sample
+    {
+        static const int numBytes = 1;
+        static int32_t read (const uint8_t* p) { return (int8_t)p[0]; }
+        static double scale() { return 1. / 128.; }
+    };
+
+    struct Int16LittleEndianSample
+    {
+        static const int numBytes = 2;
+        static const bool isBigEndian = false;
+        static int32_t read (const uint8_t* p) { return (int16_t)((p[1] << 8) | p[0]); }
+        static double scale() { return 1. / 32768.; }
+    };
+
+    struct Int16BigEndianSample
+    {
+        static const int numBytes = 2;
+        static const bool isBigEndian = true;
+        static int32_t read (const uint8_t* p) { return (int16_t)((p[0] << 8) | p[1]); }
+        static double scale() { return 1. / 32768.; }
+    };
+
+    struct Int24LittleEndianSample
+    {
+        static const int numBytes = 3;
+        static const bool isBigEndian = false;
+        static int32_t read (const uint8_t* p) { return (int32_t)(((uint32_t)p[2] << 24) | (p[1] << 16) | (p[0] << 8)) >> 8; }
+        static double scale() { return 1. / 8388608.; }
+    };
+
+    struct Int24BigEndianSample
+    {
+        static const int numBytes = 3;
+        static const bool isBigEndian = true;
+        static int32_t read (const uint8_t* p) { return (int32_t)(((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8)) >> 8; }
+        static double scale() { return 1. / 8388608.; }
+    };
+
+    //=============================================================
+    // Floating point samples are scaled to the range -1 to 1. The scales are powers
+    // of two, so multiplying by them gives exactly the same result as dividing by
+    // the full scale value.
+    template <class T, bool isInteger = std::is_integral<T>::value>
+    struct SampleConversion
+    {
+        template <class Sample>
+        static T fromPcm (int32_t value) { return (T) value * (T) Sample::scale(); }
+    };
+
+    // Integer samples are left justified instead, so that PCM data no wider than T
+    // is stored exactly and data wider than T loses only its lowest bits
+    template <class T>
+    struct SampleConversion<T, true>
+    {
+        static const int numBits = 8 * (int) sizeof (T);
+
+        template <class Sample>
+        static T fromPcm (int32_t value)
+        {
+            const int shift = numBits - 8 * Sample::numBytes;
+            return (T) (shift >= 0 ? value * ((int64_t) 1 << shift) : value >> -shift);
+        }
+    };
+
+    //=============================================================
+    template <class Sample, class T>
+    void decodeScalar (const uint8_t* source, int numChannels, int startFrame, int numFrames, T* const* channels)
+    {
+        const int numBytesPerFrame = Sample::numBytes * numChannels;
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const uint8_t* p = source + startFrame * numBytesPerFrame + channel * Sample::numBytes;
+            T* destination = channels[channel];
+
+            for (int i = startFrame; i < numFrames; i++, p += numBytesPerFrame)
+                destination[i] = SampleConversion<T>::template fromPcm<Sample> (Sample::read (p));
+        }
+    }
+
+    template <class T>
+    void decodeScalar (const uint8_t* source, PcmFormat format, int numChannels, int startFrame, int numFrames, T* const* channels)
+    {
+        switch (format)
+        {
+            case PcmFormat::UInt8: decodeScalar<UInt8Sample> (source, numChannels, startFrame, numFrames, channels); break;
+            case PcmFormat::Int8: decodeScalar<Int8Sample> (source, numChannels, startFrame, numFrames, channels); break;
+            case PcmFormat::Int16LittleEndian: decodeScalar<Int16LittleEndianSample> (source, numChannels, startFrame, numFrames, channels); break;
+            case PcmFormat::Int16BigEndian: decodeScalar<Int16BigEndianSample> (source, numChannels, startFrame, numFrames, channels); break;
+            case PcmFormat::Int24LittleEndian: decodeScalar<Int24LittleEndianSample> (source, numChannels, startFrame, numFrames, channels); break;
+            case PcmFormat::Int24BigEndian: decodeScalar<Int24BigEndianSample> (source, numChannels, startFrame, numFrames, channels); break;
+        }
+    }
+
+    //=============================================================
+    // How each format clamps and scales samples on the way out. As in AudioFile's
+    // original encoder, samples are clamped (and offset, for unsigned 8-bit data)
+    // in the precision of T, then scaled in double precision and truncated.
+    struct EncodeParameters
+    {
+        double minValue;
+        double maxValue;
+        double scale;
+        bool isOffset;
+    };
+
+    EncodeParameters getEncodeParameters (PcmFormat format)
+    {
+        EncodeParameters parameters = {-1., 1., 32767., false};
+
+        if (format == PcmFormat::UInt8)
+        {
+            parameters.scale = 255.;
+            parameters.isOffset = true;
+        }
+        else if (format == PcmFormat::Int8)
+        {
+            parameters.scale = 127.;
+        }
+        else if (format == PcmFormat::Int24LittleEndian || format == PcmFormat::Int24BigEndian)
+        {
+            // the largest sample below 1 is the largest that fits in 24 bits
+            parameters.maxValue = 8388607. / 8388608.;
+            parameters.scale = 8388608.;
+        }
+
+        return parameters;
+    }
+
+    constexpr int numBytesPerSample (PcmFormat format)
+    {
+        return (format == PcmFormat::UInt8 || format == PcmFormat::Int8) ? 1
+             : (format == PcmFormat::Int16LittleEndian || format == PcmFormat::Int16BigEndian) ? 2 : 3;
+    }
+
+    template <PcmFormat Format>
+    inline void writeSample (int32_t value, uint8_t* p)
+    {
+        if (Format == PcmFormat::UInt8 || Format == PcmFormat::Int8)
+        {
+            p[0] = (uint8_t) value;
+        }
+        else if (Format == PcmFormat::Int16LittleEndian)
+        {
+            p[0] = value & 0xFF;
+            p[1] = (value >> 8) & 0xFF;
+        }
+        else if (Format == PcmFormat::Int16BigEndian)
+        {
+            p[0] = (value >> 8) & 0xFF;
+            p[1] = value & 0xFF;
+        }
+        else if (Format == PcmFormat::Int24LittleEndian)
+        {
+            p[0] = value & 0xFF;
+            p[1] = (value >> 8) & 0xFF;
+            p[2] = (value >> 16) & 0xFF;
+        }
+        else
+        {
+            p[0] = (value >> 16) & 0xFF;
+            p[1] = (value >> 8) & 0xFF;
+            p[2] = value & 0xFF;
+        }
+    }
+
+    //=============================================================
+    template <PcmFormat Format, class T>
+    inline int32_t toPcm (T sample, const EncodeParameters& e, std::false_type /* isInteger */)
+    {
+        sample = std::max (std::min (sample, (T) e.maxValue), (T) e.minValue);
+
+        if (e.isOffset)
+            sample = (sample + (T) 1.) * (T) 0.5;
+
+        return (int32_t) ((double) sample * e.scale);
+    }
+
+    // Left justified integer samples need no clamping, just shifting down to the bit depth
+    template <PcmFormat Format, class T>
+    inline int32_t toPcm (T sample, const EncodeParameters&, std::true_type /* isInteger */)
+    {
+        const int shift = 8 * (int) sizeof (T) - 8 * numBytesPerSample (Format);
+        int32_t value = shift >= 0 ? (int32_t) (sample >> shift) : (int32_t) sample * (1 << -shift);
+
+        return Format == PcmFormat::UInt8 ? value + 128 : value;
+    }
+
+    template <PcmFormat Format, class T>
+    void encodeScalar (const T* const* channels, int numChannels, int startFrame, int numFrames, uint8_t* destination)
+    {
+        const EncodeParameters e = getEncodeParameters (Format);
+        const int numBytesPerFrame = numBytesPerSample (Format) * numChannels;
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const T* source = channels[channel];
+            uint8_t* p = destination + startFrame * numBytesPerFrame + channel * numBytesPerSample (Format);
+
+            for (int i = startFrame; i < numFrames; i++, p += numBytesPerFrame)
+                writeSample<Format> (toPcm<Format> (source[i], e, std::is_integral<T>()), p);
+        }
+    }
+
+    template <class T>
+    void encodeScalar (const T* const* channels, PcmFormat format, int numChannels, int startFrame, int numFrames, uint8_t* destination)
+    {
+        switch (format)
+        {
+            case PcmFormat::UInt8: encodeScalar<PcmFormat::UInt8> (channels, numChannels, startFrame, numFrames, destination); break;
+            case PcmFormat::Int8: encodeScalar<PcmFormat::Int8> (channels, numChannels, startFrame, numFrames, destination); break;
+            case PcmFormat::Int16LittleEndian: encodeScalar<PcmFormat::Int16LittleEndian> (channels, numChannels, startFrame, numFrames, destination); break;
+            case PcmFormat::Int16BigEndian: encodeScalar<PcmFormat::Int16BigEndian> (channels, numChannels, startFrame, numFrames, destination); break;
+            case PcmFormat::Int24LittleEndian: encodeScalar<PcmFormat::Int24LittleEndian> (channels, numChannels, startFrame, numFrames, destination); break;
+            case PcmFormat::Int24BigEndian: encodeScalar<PcmFormat::Int24BigEndian> (channels, numChannels, startFrame, numFrames, destination); break;
+        }
+    }
+
+#if PCM_KERNELS_X86
+    //=============================================================
+    // SSE2 has no byte shuffle, so only 16-bit data gets an SSE2 kernel.
+    // Each 4 sign-extended samples are either 4 mono frames or 2 stereo frames.
+    __attribute__((target ("sse2")))
+    inline void storeFourSamples (__m128i samples, float scale, int numChannels, float* const* channels, int frame)
+    {
+        if (numChannels == 1)
+        {
+            _mm_storeu_ps (channels[0] + frame, _mm_mul_ps (_mm_cvtepi32_ps (samples), _mm_set1_ps (scale)));
+        }
+        else
+        {
+            // L0 R0 L1 R1 -> L0 L1 R0 R1
+            samples = _mm_shuffle_epi32 (samples, _MM_SHUFFLE (3, 1, 2, 0));
+            __m128 f = _mm_mul_ps (_mm_cvtepi32_ps (samples), _mm_set1_ps (scale));
+            _mm_storel_pi ((__m64*)(channels[0] + frame), f);
+            _mm_storeh_pi ((__m64*)(channels[1] + frame), f);
+        }
+    }
+
+    __attribute__((target ("sse2")))
+    inline void storeFourSamples (__m128i samples, double scale, int numChannels, double* const* channels, int frame)
+    {
+        __m128d s = _mm_set1_pd (scale);
+
+        if (numChannels == 1)
+        {
+            _mm_storeu_pd (channels[0] + frame, _mm_mul_pd (_mm_cvtepi32_pd (samples), s));
+            _mm_storeu_pd (channels[0] + frame + 2, _mm_mul_pd (_mm_cvtepi32_pd (_mm_unpackhi_epi64 (samples, samples)), s));
+        }
+        else
+        {
+            samples = _mm_shuffle_epi32 (samples, _MM_SHUFFLE (3, 1, 2, 0));
+            _mm_storeu_pd (channels[0] + frame, _mm_mul_pd (_mm_cvtepi32_pd (samples), s));
+            _mm_storeu_pd (channels[1] + frame, _mm_mul_pd (_mm_cvtepi32_pd (_mm_unpackhi_epi64 (samples, samples)), s));
+        }
+    }
+
+    template <class Sample, class T>
+    __attribute__((target ("sse2")))
+    int decodeInt16Sse2 (const uint8_t* source, int numChannels, int numFrames, T* const* channels)
+    {
+        const int numSamples = numFrames * numChannels;
+        const int framesPerFourSamples = 4 / numChannels;
+        const T scale = (T) Sample::scale();
+        int frame = 0;
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128i x = _mm_loadu_si128 ((const __m128i*)(source + i * 2));
+
+            if (Sample::isBigEndian)
+                x = _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8));
+
+            // put each sample in the top half of a 32-bit lane and shift it back down to sign extend it
+            storeFourSamples (_mm_srai_epi32 (_mm_unpacklo_epi16 (x, x), 16), scale, numChannels, channels, frame);
+            storeFourSamples (_mm_srai_epi32 (_mm_unpackhi_epi16 (x, x), 16), scale, numChannels, channels, frame + framesPerFourSamples);
+            frame += 2 * framesPerFourSamples;
+        }
+
+        return frame;
+    }
+
+    template <class T>
+    int decodeSse2 (const uint8_t* source, PcmFormat format, int numChannels, int numFrames, T* const* channels)
+    {
+        switch (format)
+        {
+            case PcmFormat::Int16LittleEndian: return decodeInt16Sse2<Int16LittleEndianSample> (source, numChannels, numFrames, channels);
+            case PcmFormat::Int16BigEndian: return decodeInt16Sse2<Int16BigEndianSample> (source, numChannels, numFrames, channels);
+            default: return 0;
+        }
+    }
+
+    //=============================================================
+    // The AVX2 kernels shuffle each sample into the top bytes of a 32-bit lane and
+    // shift it back down to sign extend it, 8 samples at a time. The 8 samples are
+    // either 8 mono frames or 4 stereo frames.
+    __attribute__((target ("avx2")))
+    inline __m256i makeShuffleMask (int numBytesPerSample, bool isBigEndian, int upperLaneOffset)
+    {
+        alignas (32) int8_t mask[32];
+
+        for (int lane = 0; lane < 2; lane++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                int first = lane * upperLaneOffset + j * numBytesPerSample;
+                int8_t* m = mask + lane * 16 + j * 4;
+
+                for (int b = 0; b < 4 - numBytesPerSample; b++)
+                    m[b] = (int8_t)0x80; // zero the unused low bytes
+
+                for (int b = 0; b < numBytesPerSample; b++)
+                    m[4 - numBytesPerSample + b] = (int8_t)(isBigEndian ? first + numBytesPerSample - 1 - b : first + b);
+            }
+        }
+
+        return _mm256_load_si256 ((const __m256i*)mask);
+    }
+
+    __attribute__((target ("avx2")))
+    inline void storeEightSamples (__m256i samples, float scale, int numChannels, float* const* channels, int frame)
+    {
+        if (numChannels == 1)
+        {
+            _mm256_storeu_ps (channels[0] + frame, _mm256_mul_ps (_mm256_cvtepi32_ps (samples), _mm256_set1_ps (scale)));
+        }
+        else
+        {
+            // L0 R0 L1 R1 L2 R2 L3 R3 -> L0 L1 L2 L3 R0 R1 R2 R3
+            samples = _mm256_permutevar8x32_epi32 (samples, _mm256_setr_epi32 (0, 2, 4, 6, 1, 3, 5, 7));
+            __m256 f = _mm256_mul_ps (_mm256_cvtepi32_ps (samples), _mm256_set1_ps (scale));
+            _mm_storeu_ps (channels[0] + frame, _mm256_castps256_ps128 (f));
+            _mm_storeu_ps (channels[1] + frame, _mm256_extractf128_ps (f, 1));
+        }
+    }
+
+    __attribute__((target ("avx2")))
+    inline void storeEightSamples (__m256i samples, double scale, int numChannels, double* const* channels, int frame)
+    {
+        __m256d s = _mm256_set1_pd (scale);
+
+        if (numChannels == 1)
+        {
+            _mm256_storeu_pd (channels[0] + frame, _mm256_mul_pd (_mm256_cvtepi32_pd (_mm256_castsi256_si128 (samples)), s));
+            _mm256_storeu_pd (channels[0] + frame + 4, _mm256_mul_pd (_mm256_cvtepi32_pd (_mm256_extracti128_si256 (samples, 1)), s));
+        }
+        else
+        {
+            samples = _mm256_permutevar8x32_epi32 (samples, _mm256_setr_epi32 (0, 2, 4, 6, 1, 3, 5, 7));
+            _mm256_storeu_pd (channels[0] + frame, _mm256_mul_pd (_mm256_cvtepi32_pd (_mm256_castsi256_si128 (samples)), s));
+            _mm256_storeu_pd (channels[1] + frame, _mm256_mul_pd (_mm256_cvtepi32_pd (_mm256_extracti128_si256 (samples, 1)), s));
+        }
+    }
+
+    template <class Sample, class T>
+    __attribute__((target ("avx2")))
+    int decodeAvx2 (const uint8_t* source, int numChannels, int numFrames, T* const* channels)
+    {
+        const int numSamples = numFrames * numChannels;
+        const int framesPerEightSamples = 8 / numChannels;
+        const int shift = 32 - 8 * Sample::numBytes;
+        const T scale = (T) Sample::scale();
+        int frame = 0;
+        int i = 0;
+
+        if (Sample::numBytes == 2)
+        {
+            // both lanes get the same 16 bytes, the upper lane takes samples 4 to 7
+            const __m256i mask = makeShuffleMask (2, Sample::isBigEndian, 8);
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                __m256i x = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i*)(source + i * 2)));
+                storeEightSamples (_mm256_srai_epi32 (_mm256_shuffle_epi8 (x, mask), shift), scale, numChannels, channels, frame);
+                frame += framesPerEightSamples;
+            }
+        }
+        else
+        {
+            // each lane loads 16 bytes starting at its 4 samples. The upper lane's load runs 4 bytes
+            // past the 8th sample, so stop while there are still at least 2 samples to spare.
+            const __m256i mask = makeShuffleMask (3, Sample::isBigEndian, 0);
+
+            for (; i + 10 <= numSamples; i += 8)
+            {
+                const uint8_t* p = source + i * 3;
+                __m256i x = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i*)p)), _mm_loadu_si128 ((const __m128i*)(p + 12)), 1);
+                storeEightSamples (_mm256_srai_epi32 (_mm256_shuffle_epi8 (x, mask), shift), scale, numChannels, channels, frame);
+                frame += framesPerEightSamples;
+            }
+        }
+
+        return frame;
+    }
+
+    template <class T>
+    int decodeAvx2 (const uint8_t* source, PcmFormat format, int numChannels, int numFrames, T* const* channels)
+    {
+        switch (format)
+        {
+            case PcmFormat::Int16LittleEndian: return decodeAvx2<Int16LittleEndianSample> (source, numChannels, numFrames, channels);
+            case PcmFormat::Int16BigEndian: return decodeAvx2<Int16BigEndianSample> (source, numChannels, numFrames, channels);
+            case PcmFormat::Int24LittleEndian: return decodeAvx2<Int24LittleEndianSample> (source, numChannels, numFrames, channels);
+            case PcmFormat::Int24BigEndian: return decodeAvx2<Int24BigEndianSample> (source, numChannels, numFrames, channels);
+            default: return 0;
+        }
+    }
+
+    //=============================================================
+    // The encode kernels clamp and scale 4 samples of one channel at a time into
+    // 32-bit integers, interleave the channels, and pack the integers into bytes.
+    // SSE2 has no byte shuffle, so it doesn't get the 24-bit kernels.
+    __attribute__((target ("sse2")))
+    inline __m128i scaleFourSamplesSse2 (const float* p, const EncodeParameters& e)
+    {
+        __m128 x = _mm_max_ps (_mm_min_ps (_mm_loadu_ps (p), _mm_set1_ps ((float) e.maxValue)), _mm_set1_ps ((float) e.minValue));
+
+        if (e.isOffset)
+            x = _mm_mul_ps (_mm_add_ps (x, _mm_set1_ps (1.f)), _mm_set1_ps (0.5f));
+
+        __m128d scale = _mm_set1_pd (e.scale);
+        __m128i low = _mm_cvttpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (x), scale));
+        __m128i high = _mm_cvttpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (_mm_movehl_ps (x, x)), scale));
+        return _mm_unpacklo_epi64 (low, high);
+    }
+
+    __attribute__((target ("sse2")))
+    inline __m128i scaleFourSamplesSse2 (const double* p, const EncodeParameters& e)
+    {
+        __m128d minValue = _mm_set1_pd (e.minValue);
+        __m128d maxValue = _mm_set1_pd (e.maxValue);
+        __m128d x0 = _mm_max_pd (_mm_min_pd (_mm_loadu_pd (p), maxValue), minValue);
+        __m128d x1 = _mm_max_pd (_mm_min_pd (_mm_loadu_pd (p + 2), maxValue), minValue);
+
+        if (e.isOffset)
+        {
+            x0 = _mm_mul_pd (_mm_add_pd (x0, _mm_set1_pd (1.)), _mm_set1_pd (0.5));
+            x1 = _mm_mul_pd (_mm_add_pd (x1, _mm_set1_pd (1.)), _mm_set1_pd (0.5));
+        }
+
+        __m128d scale = _mm_set1_pd (e.scale);
+        return _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (_mm_mul_pd (x0, scale)), _mm_cvttpd_epi32 (_mm_mul_pd (x1, scale)));
+    }
+
+    template <PcmFormat Format>
+    __attribute__((target ("sse2")))
+    inline void storeFourSamplesSse2 (__m128i samples, uint8_t* p)
+    {
+        __m128i words = _mm_packs_epi32 (samples, samples);
+
+        if (Format == PcmFormat::UInt8 || Format == PcmFormat::Int8)
+        {
+            __m128i bytes = Format == PcmFormat::UInt8 ? _mm_packus_epi16 (words, words) : _mm_packs_epi16 (words, words);
+            int32_t fourBytes = _mm_cvtsi128_si32 (bytes);
+            memcpy (p, &fourBytes, 4);
+        }
+        else
+        {
+            if (Format == PcmFormat::Int16BigEndian)
+                words = _mm_or_si128 (_mm_slli_epi16 (words, 8), _mm_srli_epi16 (words, 8));
+
+            _mm_storel_epi64 ((__m128i*)p, words);
+        }
+    }
+
+    template <PcmFormat Format, class T>
+    __attribute__((target ("sse2")))
+    int encodeSse2 (const T* const* channels, int numChannels, int numFrames, uint8_t* destination)
+    {
+        const EncodeParameters e = getEncodeParameters (Format);
+        const int numBytesPerFourSamples = 4 * numBytesPerSample (Format);
+        int i = 0;
+
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            uint8_t* p = destination + i * numChannels * numBytesPerSample (Format);
+
+            if (numChannels == 1)
+            {
+                storeFourSamplesSse2<Format> (scaleFourSamplesSse2 (channels[0] + i, e), p);
+            }
+            else
+            {
+                __m128i left = scaleFourSamplesSse2 (channels[0] + i, e);
+                __m128i right = scaleFourSamplesSse2 (channels[1] + i, e);
+                storeFourSamplesSse2<Format> (_mm_unpacklo_epi32 (left, right), p);
+                storeFourSamplesSse2<Format> (_mm_unpackhi_epi32 (left, right), p + numBytesPerFourSamples);
+            }
+        }
+
+        return i;
+    }
+
+    template <class T>
+    int encodeSse2 (const T* const* channels, PcmFormat format, int numChannels, int numFrames, uint8_t* destination)
+    {
+        switch (format)
+        {
+            case PcmFormat::UInt8: return encodeSse2<PcmFormat::UInt8> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int8: return encodeSse2<PcmFormat::Int8> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int16LittleEndian: return encodeSse2<PcmFormat::Int16LittleEndian> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int16BigEndian: return encodeSse2<PcmFormat::Int16BigEndian> (channels, numChannels, numFrames, destination);
+            default: return 0;
+        }
+    }
+
+    __attribute__((target ("avx2")))
+    inline __m128i scaleFourSamplesAvx2 (const float* p, const EncodeParameters& e)
+    {
+        __m128 x = _mm_max_ps (_mm_min_ps (_mm_loadu_ps (p), _mm_set1_ps ((float) e.maxValue)), _mm_set1_ps ((float) e.minValue));
+
+        if (e.isOffset)
+            x = _mm_mul_ps (_mm_add_ps (x, _mm_set1_ps (1.f)), _mm_set1_ps (0.5f));
+
+        return _mm256_cvttpd_epi32 (_mm256_mul_pd (_mm256_cvtps_pd (x), _mm256_set1_pd (e.scale)));
+    }
+
+    __attribute__((target ("avx2")))
+    inline __m128i scaleFourSamplesAvx2 (const double* p, const EncodeParameters& e)
+    {
+        __m256d x = _mm256_max_pd (_mm256_min_pd (_mm256_loadu_pd (p), _mm256_set1_pd (e.maxValue)), _mm256_set1_pd (e.minValue));
+
+        if (e.isOffset)
+            x = _mm256_mul_pd (_mm256_add_pd (x, _mm256_set1_pd (1.)), _mm256_set1_pd (0.5));
+
+        return _mm256_cvttpd_epi32 (_mm256_mul_pd (x, _mm256_set1_pd (e.scale)));
+    }
+
+    template <PcmFormat Format>
+    __attribute__((target ("avx2")))
+    inline void storeFourSamplesAvx2 (__m128i samples, uint8_t* p)
+    {
+        if (Format == PcmFormat::Int24LittleEndian || Format == PcmFormat::Int24BigEndian)
+        {
+            // drop the top byte of each sample, leaving 12 packed bytes
+            const __m128i mask = Format == PcmFormat::Int24LittleEndian
+                ? _mm_setr_epi8 (0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1)
+                : _mm_setr_epi8 (2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+            __m128i bytes = _mm_shuffle_epi8 (samples, mask);
+            int32_t lastFourBytes = _mm_cvtsi128_si32 (_mm_srli_si128 (bytes, 8));
+            _mm_storel_epi64 ((__m128i*)p, bytes);
+            memcpy (p + 8, &lastFourBytes, 4);
+        }
+        else
+        {
+            storeFourSamplesSse2<Format> (samples, p);
+        }
+    }
+
+    template <PcmFormat Format, class T>
+    __attribute__((target ("avx2")))
+    int encodeAvx2 (const T* const* channels, int numChannels, int numFrames, uint8_t* destination)
+    {
+        const EncodeParameters e = getEncodeParameters (Format);
+        const int numBytesPerFourSamples = 4 * numBytesPerSample (Format);
+        int i = 0;
+
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            uint8_t* p = destination + i * numChannels * numBytesPerSample (Format);
+
+            if (numChannels == 1)
+            {
+                storeFourSamplesAvx2<Format> (scaleFourSamplesAvx2 (channels[0] + i, e), p);
+            }
+            else
+            {
+                __m128i left = scaleFourSamplesAvx2 (channels[0] + i, e);
+                __m128i right = scaleFourSamplesAvx2 (channels[1] + i, e);
+                storeFourSamplesAvx2<Format> (_mm_unpacklo_epi32 (left, right), p);
+                storeFourSamplesAvx2<Format> (_mm_unpackhi_epi32 (left, right), p + numBytesPerFourSamples);
+            }
+        }
+
+        return i;
+    }
+
+    template <class T>
+    int encodeAvx2 (const T* const* channels, PcmFormat format, int numChannels, int numFrames, uint8_t* destination)
+    {
+        switch (format)
+        {
+            case PcmFormat::UInt8: return encodeAvx2<PcmFormat::UInt8> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int8: return encodeAvx2<PcmFormat::Int8> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int16LittleEndian: return encodeAvx2<PcmFormat::Int16LittleEndian> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int16BigEndian: return encodeAvx2<PcmFormat::Int16BigEndian> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int24LittleEndian: return encodeAvx2<PcmFormat::Int24LittleEndian> (channels, numChannels, numFrames, destination);
+            case PcmFormat::Int24BigEndian: return encodeAvx2<PcmFormat::Int24BigEndian> (channels, numChannels, numFrames, destination);
+        }
+
+        return 0;
+    }
+#endif
+
+    //=============================================================
+    // The SIMD kernels only produce floating point samples, so integer samples
+    // always take the scalar kernels, which are already little more than copies
+    template <class T>
+    int decodeSimd (PcmInstructionSet instructionSet, const uint8_t* source, PcmFormat format, int numChannels, int numFrames, T* const* channels, std::false_type /* isInteger */)
+    {
+#if PCM_KERNELS_X86
+        if (instructionSet == PcmInstructionSet::AVX2)
+            return decodeAvx2 (source, format, numChannels, numFrames, channels);
+        else if (instructionSet == PcmInstructionSet::SSE2)
+            return decodeSse2 (source, format, numChannels, numFrames, channels);
+#endif
+        return 0;
+    }
+
+    template <class T>
+    int decodeSimd (PcmInstructionSet, const uint8_t*, PcmFormat, int, int, T* const*, std::true_type /* isInteger */)
+    {
+        return 0;
+    }
+
+    template <class T>
+    int encodeSimd (PcmInstructionSet instructionSet, const T* const* channels, PcmFormat format, int numChannels, int numFrames, uint8_t* destination, std::false_type /* isInteger */)
+    {
+#if PCM_KERNELS_X86
+        if (instructionSet == PcmInstructionSet::AVX2)
+            return encodeAvx2 (channels, format, numChannels, numFrames, destination);
+        else if (instructionSet == PcmInstructionSet::SSE2)
+            return encodeSse2 (channels, format, numChannels, numFrames, destination);
+#endif
+        return 0;
+    }
+
+    template <class T>
+    int encodeSimd (PcmInstructionSet, const T* const*, PcmFormat, int, int, uint8_t*, std::true_type /* isInteger */)
+    {
+        return 0;
+    }
+
+    //=============================================================
+    PcmInstructionSet getBestInstructionSet()
+    {
+#if PCM_KERNELS_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports ("avx2"))
+            return PcmInstructionSet::AVX2;
+
+        if (__builtin_cpu_supports ("sse2"))
+            return PcmInstructionSet::SSE2;
+#endif
+        return PcmInstructionSet::Scalar;
+    }
+
+    std::atomic<int>& currentInstructionSet()
+    {
+        static std::atomic<int> instructionSet ((int) getBestInstructionSet());
+        return instructionSet;
+    }
+}
+
+//=============================================================
+PcmFormat PcmKernels::getFormat (int bitDepth, bool isBigEndian)
+{
+    if (bitDepth == 8)
+        return isBigEndian ? PcmFormat::Int8 : PcmFormat::UInt8;
+    else if (bitDepth == 16)
+        return isBigEndian ? PcmFormat::Int16BigEndian : PcmFormat::Int16LittleEndian;
+    else
+        return isBigEndian ? PcmFormat::Int24BigEndian : PcmFormat::Int24LittleEndian;
+}
+
+//=============================================================
+int PcmKernels::getNumBytesPerSample (PcmFormat format)
+{
+    switch (format)
+    {
+        case PcmFormat::UInt8:
+        case PcmFormat::Int8:
+            return 1;
+        case PcmFormat::Int16LittleEndian:
+        case PcmFormat::Int16BigEndian:
+            return 2;
+        default:
+            return 3;
+    }
+}
+
+//=============================================================
+template <class T>
+void PcmKernels::decode (const uint8_t* source, PcmFormat format, int numChannels, int numFrames, T* const* channels)
+{
+    int numFramesDone = 0;
+
+    if (numChannels == 1 || numChannels == 2)
+        numFramesDone = decodeSimd (getInstructionSet(), source, format, numChannels, numFrames, channels, std::is_integral<T>());
+
+    decodeScalar (source, format, numChannels, numFramesDone, numFrames, channels);
+}
+
+//=============================================================
+template <class T>
+void PcmKernels::encode (const T* const* channels, PcmFormat format, int numChannels, int numFrames, uint8_t* destination)
+{
+    int numFramesDone = 0;
+
+    if (numChannels == 1 || numChannels == 2)
+        numFramesDone = encodeSimd (getInstructionSet(), channels, format, numChannels, numFrames, destination, std::is_integral<T>());
+
+    encodeScalar (channels, format, numChannels, numFramesDone, numFrames, destination);
+}
+
+//=============================================================
+PcmInstructionSet PcmKernels::getInstructionSet()
+{
+    return (PcmInstructionSet) currentInstructionSet().load (std::memory_order_relaxed);
+}
+
+//=============================================================
+PcmInstructionSet PcmKernels::setInstructionSet (PcmInstructionSet instructionSet)
+{
+    PcmInstructionSet best = getBestInstructionSet();
+
+    if ((int) instructionSet > (int) best)
+        instructionSet = best;
+
+    currentInstructionSet().store ((int) instructionSet, std::memory_order_relaxed);
+
+    return instructionSet;
+}
+
+//=============================================================
+const char* PcmKernels::getInstructionSetName (PcmInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+        case PcmInstructionSet::AVX2: return "AVX2";
+        case PcmInstructionSet::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+//===========================================================
+template void PcmKernels::decode<float> (const uint8_t*, PcmFormat, int, int, float* const*);
+template void PcmKernels::decode<double> (const uint8_t*, PcmFormat, int, int, double* const*);
+template void PcmKernels::encode<float> (const float* const*, PcmFormat, int, int, uint8_t*);
+template void PcmKernels::encode<double> (const double* const*, PcmFormat, int, int, uint8_t*);
+template void PcmKernels::decode<int16_t> (const uint8_t*, PcmFormat, int, int, int16_t* const*);
+template void PcmKernels::decode<int32_t> (const uint8_t*, PcmFormat, int, int, int32_t* const*);
+template void PcmKernels::encode<int16_t> (const int16_t* const*, PcmFormat, int, int, uint8_t*);
+template void PcmKernels::encode<int32_t> (const int32_t* const*, PcmFormat, int, int, uint8_t*);
@@ -0,0 +1,86 @@
+//=======================================================================
+/** @file PcmKernels.h
+ *
+ * Conversion, in both directions, between interleaved PCM bytes as stored
+ * in .wav and .aiff files and the per-channel sample buffers used by
+ * AudioFile. Each kernel handles a whole block of frames in one call, using
+ * SSE2 or AVX2 where the CPU supports them and a plain loop otherwise. The
+ * instruction set is chosen the first time a kernel is used.
+ *
+ * Samples can be float, double, int16_t or int32_t. Floating point samples
+ * are in the range -1 to 1. Integer samples are left justified, so full
+ * scale is the range of the type whatever the bit depth: 16-bit data is
+ * stored exactly in an int16_t and shifted up by 16 bits in an int32_t,
+ * while 24-bit data in an int16_t loses its lowest 8 bits.
+ */
+//=======================================================================
+
+#ifndef _AS_PcmKernels_h
+#define _AS_PcmKernels_h
+
+#include <stdint.h>
+
+//=============================================================
+/** The packed sample formats the kernels understand. 8-bit .wav data
+ * is unsigned and 8-bit .aiff data is signed.
+ */
+enum class PcmFormat
+{
+    UInt8,
+    Int8,
+    Int16LittleEndian,
+    Int16BigEndian,
+    Int24LittleEndian,
+    Int24BigEndian
+};
+
+//=============================================================
+/** The instruction sets a kernel can be run with */
+enum class PcmInstructionSet
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+namespace PcmKernels
+{
+    //=============================================================
+    /** @Returns the format of samples with the given bit depth, in the byte order of .aiff
+     * files if isBigEndian is true and of .wav files otherwise
+     */
+    PcmFormat getFormat (int bitDepth, bool isBigEndian);
+
+    /** @Returns the number of bytes used by one sample of the given format */
+    int getNumBytesPerSample (PcmFormat format);
+
+    //=============================================================
+    /** Deinterleaves numFrames frames of packed PCM data and converts them to samples, in
+     * the range -1 to 1 or left justified integers, writing one sample per frame into each of the numChannels arrays
+     * in channels. The arrays must already hold at least numFrames samples.
+     */
+    template <class T>
+    void decode (const uint8_t* source, PcmFormat format, int numChannels, int numFrames, T* const* channels);
+
+    /** Clamps, scales and interleaves numFrames frames from each of the numChannels arrays in
+     * channels, writing them as packed PCM data to destination. The destination must have room
+     * for numFrames * numChannels * getNumBytesPerSample (format) bytes.
+     */
+    template <class T>
+    void encode (const T* const* channels, PcmFormat format, int numChannels, int numFrames, uint8_t* destination);
+
+    //=============================================================
+    /** @Returns the instruction set the kernels are currently using */
+    PcmInstructionSet getInstructionSet();
+
+    /** Makes the kernels use the given instruction set, or the best one the CPU supports
+     * if it doesn't support the one asked for. Useful for testing and benchmarking.
+     * @Returns the instruction set that will be used
+     */
+    PcmInstructionSet setInstructionSet (PcmInstructionSet instructionSet);
+
+    /** @Returns the name of an instruction set */
+    const char* getInstructionSetName (PcmInstructionSet instructionSet);
+}
+
+#endif /* _AS_PcmKernels_h */
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include "PcmKernels.h"
+
+//------------------------------------------------------------
+// Compares the PCM decode and encode kernels with the sample by
+// sample loops that AudioFile used to read and write .wav files with.
+// Build and run from the top level directory with
+//     g++ -std=c++11 -O2 Pcm_Benchmark.cpp PcmKernels.cc -o pcm_benchmark
+//     ./pcm_benchmark
+//------------------------------------------------------------
+
+using namespace std::chrono;
+
+typedef std::vector<std::vector<double> > AudioBuffer;
+
+// The old decode loop: a bit depth branch, a byte by byte read
+// and a push_back for every sample
+void decode_sample_by_sample(std::vector<uint8_t>& fileData, int bitDepth, int numChannels, int numSamples, AudioBuffer& samples){
+    int numBytesPerSample = bitDepth / 8;
+    int numBytesPerBlock = numChannels * numBytesPerSample;
+    samples.clear();
+    samples.resize (numChannels);
+    for (int i = 0; i < numSamples; i++)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            int sampleIndex = (numBytesPerBlock * i) + channel * numBytesPerSample;
+            if (bitDepth == 16)
+            {
+                int16_t sampleAsInt = (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
+                samples[channel].push_back (static_cast<double> (sampleAsInt) / static_cast<double> (32768.));
+            }
+            else if (bitDepth == 24)
+            {
+                int32_t sampleAsInt = (fileData[sampleIndex + 2] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
+                if (sampleAsInt & 0x800000)
+                    sampleAsInt = sampleAsInt | ~0xFFFFFF;
+                samples[channel].push_back ((double)sampleAsInt / (double)8388608.);
+            }
+        }
+    }
+}
+
+// Decodes into presized channel buffers with whichever kernel is selected
+void decode_with_kernel(std::vector<uint8_t>& fileData, int bitDepth, int numChannels, int numSamples, AudioBuffer& samples){
+    samples.resize (numChannels);
+    std::vector<double*> channels (numChannels);
+    for (int channel = 0; channel < numChannels; channel++){
+        samples[channel].resize (numSamples);
+        channels[channel] = samples[channel].data();
+    }
+    PcmKernels::decode (fileData.data(), PcmKernels::getFormat (bitDepth, false), numChannels, numSamples, channels.data());
+}
+
+// The old encode loop: a clamp, a bit depth branch and a push_back
+// for every byte
+void encode_sample_by_sample(AudioBuffer& samples, int bitDepth, std::vector<uint8_t>& fileData){
+    int numChannels = (int)samples.size();
+    int numSamples = (int)samples[0].size();
+    fileData.clear();
+    for (int i = 0; i < numSamples; i++)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            double sample = samples[channel][i];
+            if (bitDepth == 16)
+            {
+                sample = std::max (std::min (sample, 1.), -1.);
+                int16_t sampleAsInt = static_cast<int16_t> (sample * 32767.);
+                fileData.push_back (sampleAsInt & 0xFF);
+                fileData.push_back ((sampleAsInt >> 8) & 0xFF);
+            }
+            else if (bitDepth == 24)
+            {
+                sample = std::max (std::min (sample, 8388607. / 8388608.), -1.);
+                int32_t sampleAsInt = (int32_t) (sample * 8388608.);
+                fileData.push_back ((uint8_t) sampleAsInt & 0xFF);
+                fileData.push_back ((uint8_t) (sampleAsInt >> 8) & 0xFF);
+                fileData.push_back ((uint8_t) (sampleAsInt >> 16) & 0xFF);
+            }
+        }
+    }
+}
+
+// Encodes into a presized byte buffer with whichever kernel is selected
+void encode_with_kernel(AudioBuffer& samples, int bitDepth, std::vector<uint8_t>& fileData){
+    int numChannels = (int)samples.size();
+    int numSamples = (int)samples[0].size();
+    std::vector<const double*> channels (numChannels);
+    for (int channel = 0; channel < numChannels; channel++){
+        channels[channel] = samples[channel].data();
+    }
+    fileData.resize ((size_t)numSamples * numChannels * bitDepth / 8);
+    PcmKernels::encode (channels.data(), PcmKernels::getFormat (bitDepth, false), numChannels, numSamples, fileData.data());
+}
+
+// Runs a decode or encode a few times and returns the best time in milliseconds
+template <class F>
+double best_time(F decode, int repeats){
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++){
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        decode();
+        duration<double, std::milli> elapsed = high_resolution_clock::now() - start;
+        if (elapsed.count() < best){
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+void run_benchmark(int bitDepth, int numChannels, int numSamples){
+    // Random PCM data stands in for a recording
+    std::vector<uint8_t> fileData ((size_t)numSamples * numChannels * bitDepth / 8);
+    srand (1);
+    for (size_t i = 0; i < fileData.size(); i++){
+        fileData[i] = (uint8_t) rand();
+    }
+    double megabytes = fileData.size() / 1e6;
+
+    AudioBuffer reference;
+    double reference_time = best_time([&]() { decode_sample_by_sample (fileData, bitDepth, numChannels, numSamples, reference); }, 3);
+    std::cout << bitDepth << "-bit, " << numChannels << " channel(s), " << megabytes << " MB" << std::endl;
+    std::cout << "  decode" << std::endl;
+    std::cout << "    sample by sample: " << reference_time << " ms (" << megabytes / reference_time * 1000 << " MB/s)" << std::endl;
+
+    PcmInstructionSet instruction_sets[] = {PcmInstructionSet::Scalar, PcmInstructionSet::SSE2, PcmInstructionSet::AVX2};
+    for (PcmInstructionSet instruction_set : instruction_sets){
+        if (PcmKernels::setInstructionSet (instruction_set) != instruction_set){
+            continue;
+        }
+        AudioBuffer samples;
+        double kernel_time = best_time([&]() { decode_with_kernel (fileData, bitDepth, numChannels, numSamples, samples); }, 3);
+        std::cout << "    " << PcmKernels::getInstructionSetName (instruction_set) << " kernel: " << kernel_time << " ms ("
+                  << megabytes / kernel_time * 1000 << " MB/s, " << reference_time / kernel_time << "x)"
+                  << (samples == reference ? "" : " MISMATCH") << std::endl;
+    }
+
+    std::vector<uint8_t> reference_bytes;
+    reference_time = best_time([&]() { encode_sample_by_sample (reference, bitDepth, reference_bytes); }, 3);
+    std::cout << "  encode" << std::endl;
+    std::cout << "    sample by sample: " << reference_time << " ms (" << megabytes / reference_time * 1000 << " MB/s)" << std::endl;
+
+    for (PcmInstructionSet instruction_set : instruction_sets){
+        if (PcmKernels::setInstructionSet (instruction_set) != instruction_set){
+            continue;
+        }
+        std::vector<uint8_t> encoded;
+        double kernel_time = best_time([&]() { encode_with_kernel (reference, bitDepth, encoded); }, 3);
+        std::cout << "    " << PcmKernels::getInstructionSetName (instruction_set) << " kernel: " << kernel_time << " ms ("
+                  << megabytes / kernel_time * 1000 << " MB/s, " << reference_time / kernel_time << "x)"
+                  << (encoded == reference_bytes ? "" : " MISMATCH") << std::endl;
+    }
+}
+
+// ==================== MAIN ======================
+int main(){
+
+// About ten minutes of 44.1kHz audio
+int num_samples = 44100 * 600;
+
+run_benchmark(16, 2, num_samples);
+run_benchmark(24, 2, num_samples);
+run_benchmark(16, 1, num_samples);
+run_benchmark(24, 1, num_samples);
+
+return 0;
+}
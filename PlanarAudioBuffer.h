@@ -0,0 +1,325 @@
+//=======================================================================
+/** @file PlanarAudioBuffer.h
+ *
+ * A multi-channel sample buffer that keeps every channel in one aligned
+ * block of memory, plus non-owning views onto a single channel or onto a
+ * range of frames across all channels. Views are cheap to copy and are
+ * how regions of a buffer are passed around without copying samples.
+ * Frame counts and indices are 64-bit, so a buffer can hold more than
+ * 2^31 frames.
+ */
+//=======================================================================
+
+#ifndef _AS_PlanarAudioBuffer_h
+#define _AS_PlanarAudioBuffer_h
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <new>
+
+//=============================================================
+/** A non-owning view of a run of samples in one channel. Use
+ * AudioChannelView<const T> for a read-only view.
+ */
+template <class T>
+class AudioChannelView
+{
+public:
+
+    //=============================================================
+    /** Constructs an empty view */
+    AudioChannelView() : samples (nullptr), numSamples (0) {}
+
+    /** Constructs a view of numSamples samples starting at samples */
+    AudioChannelView (T* samples_, int64_t numSamples_) : samples (samples_), numSamples (numSamples_) {}
+
+    /** Converts a view of non-const samples to a view of const samples */
+    template <class U>
+    AudioChannelView (const AudioChannelView<U>& other) : samples (other.data()), numSamples (other.size()) {}
+
+    //=============================================================
+    T& operator[] (int64_t index) const
+    {
+        assert (index >= 0 && index < numSamples);
+        return samples[index];
+    }
+
+    /** @Returns a pointer to the first sample */
+    T* data() const { return samples; }
+
+    /** @Returns the number of samples in the view */
+    int64_t size() const { return numSamples; }
+
+    /** @Returns true if the view has no samples */
+    bool empty() const { return numSamples == 0; }
+
+    T* begin() const { return samples; }
+    T* end() const { return samples + numSamples; }
+
+    //=============================================================
+    /** @Returns a view of numSamples samples of this view, starting at startIndex */
+    AudioChannelView getRange (int64_t startIndex, int64_t numSamples_) const
+    {
+        assert (startIndex >= 0 && numSamples_ >= 0 && startIndex + numSamples_ <= numSamples);
+        return AudioChannelView (samples + startIndex, numSamples_);
+    }
+
+private:
+
+    //=============================================================
+    T* samples;
+    int64_t numSamples;
+};
+
+//=============================================================
+/** A non-owning view of a range of frames across every channel of a
+ * PlanarAudioBuffer. Channel c of the view starts channelStride samples
+ * after channel c - 1, so the view can be indexed just like the buffer:
+ *
+ *      view[channel][frameIndex]
+ */
+template <class T>
+class AudioBufferView
+{
+public:
+
+    //=============================================================
+    /** Constructs an empty view */
+    AudioBufferView() : samples (nullptr), numChannels (0), numFrames (0), channelStride (0) {}
+
+    /** Constructs a view of numFrames frames of numChannels channels, the first of which starts at samples */
+    AudioBufferView (T* samples_, int numChannels_, int64_t numFrames_, int64_t channelStride_)
+        : samples (samples_), numChannels (numChannels_), numFrames (numFrames_), channelStride (channelStride_) {}
+
+    /** Converts a view of non-const samples to a view of const samples */
+    template <class U>
+    AudioBufferView (const AudioBufferView<U>& other)
+        : samples (other.data()), numChannels (other.getNumChannels()), numFrames (other.getNumFrames()), channelStride (other.getChannelStride()) {}
+
+    //=============================================================
+    AudioChannelView<T> operator[] (int channel) const
+    {
+        assert (channel >= 0 && channel < numChannels);
+        return AudioChannelView<T> (samples + (size_t)channel * channelStride, numFrames);
+    }
+
+    /** @Returns the number of channels in the view */
+    int getNumChannels() const { return numChannels; }
+
+    /** @Returns the number of frames in the view */
+    int64_t getNumFrames() const { return numFrames; }
+
+    /** @Returns the distance, in samples, from the start of one channel to the start of the next */
+    int64_t getChannelStride() const { return channelStride; }
+
+    /** @Returns a pointer to the first sample of the first channel */
+    T* data() const { return samples; }
+
+    /** @Returns the number of channels, so that the view can be used like an AudioFile<T>::AudioBuffer */
+    int size() const { return numChannels; }
+
+    //=============================================================
+    /** @Returns a view of numFrames_ frames of this view, starting at startFrame */
+    AudioBufferView getFrames (int64_t startFrame, int64_t numFrames_) const
+    {
+        assert (startFrame >= 0 && numFrames_ >= 0 && startFrame + numFrames_ <= numFrames);
+        return AudioBufferView (samples + startFrame, numChannels, numFrames_, channelStride);
+    }
+
+private:
+
+    //=============================================================
+    T* samples;
+    int numChannels;
+    int64_t numFrames;
+    int64_t channelStride;
+};
+
+//=============================================================
+/** Owns the samples of several channels of audio. The channels are stored
+ * one after the other in a single allocation, and each one starts on an
+ * alignment byte boundary so that SIMD code can use aligned loads. Samples
+ * are accessed by channel and then by frame, i.e:
+ *
+ *      buffer[channel][frameIndex]
+ */
+template <class T>
+class PlanarAudioBuffer
+{
+public:
+
+    //=============================================================
+    /** The byte boundary that every channel starts on */
+    static const int alignment = 64;
+
+    //=============================================================
+    /** Constructs a buffer with no channels */
+    PlanarAudioBuffer() : allocation (nullptr), samples (nullptr), numChannels (0), numFrames (0), channelStride (0) {}
+
+    /** Constructs a buffer of the given size, filled with zeros */
+    PlanarAudioBuffer (int numChannels_, int64_t numFrames_) : PlanarAudioBuffer()
+    {
+        setSize (numChannels_, numFrames_);
+    }
+
+    PlanarAudioBuffer (const PlanarAudioBuffer& other) : PlanarAudioBuffer()
+    {
+        *this = other;
+    }
+
+    PlanarAudioBuffer (PlanarAudioBuffer&& other) : PlanarAudioBuffer()
+    {
+        swap (other);
+    }
+
+    ~PlanarAudioBuffer()
+    {
+        ::operator delete (allocation);
+    }
+
+    PlanarAudioBuffer& operator= (const PlanarAudioBuffer& other)
+    {
+        if (this != &other)
+        {
+            allocate (other.numChannels, other.numFrames);
+
+            for (int channel = 0; channel < numChannels; channel++)
+                std::copy (other[channel].begin(), other[channel].end(), getChannelPointer (channel));
+        }
+
+        return *this;
+    }
+
+    PlanarAudioBuffer& operator= (PlanarAudioBuffer&& other)
+    {
+        swap (other);
+        return *this;
+    }
+
+    //=============================================================
+    /** Sets the number of channels and frames, keeping as much of the existing audio
+     * as fits and filling any new channels or frames with zeros
+     */
+    void setSize (int newNumChannels, int64_t newNumFrames)
+    {
+        assert (newNumChannels >= 0 && newNumFrames >= 0);
+
+        if (newNumChannels == numChannels && newNumFrames == numFrames)
+            return;
+
+        PlanarAudioBuffer resized;
+        resized.allocate (newNumChannels, newNumFrames);
+
+        for (int channel = 0; channel < newNumChannels; channel++)
+        {
+            T* destination = resized.getChannelPointer (channel);
+            int64_t numFramesToKeep = channel < numChannels ? std::min (numFrames, newNumFrames) : 0;
+
+            std::copy (getChannelPointer (channel), getChannelPointer (channel) + numFramesToKeep, destination);
+            std::fill (destination + numFramesToKeep, destination + newNumFrames, (T)0.);
+        }
+
+        swap (resized);
+    }
+
+    /** Sets the number of channels and frames without keeping or zeroing any samples, for
+     * when every sample is about to be overwritten
+     */
+    void setSizeUninitialised (int newNumChannels, int64_t newNumFrames)
+    {
+        assert (newNumChannels >= 0 && newNumFrames >= 0);
+
+        if (newNumChannels != numChannels || newNumFrames != numFrames)
+            allocate (newNumChannels, newNumFrames);
+    }
+
+    /** Removes every channel and frees the samples */
+    void clear()
+    {
+        PlanarAudioBuffer empty;
+        swap (empty);
+    }
+
+    void swap (PlanarAudioBuffer& other)
+    {
+        std::swap (allocation, other.allocation);
+        std::swap (samples, other.samples);
+        std::swap (numChannels, other.numChannels);
+        std::swap (numFrames, other.numFrames);
+        std::swap (channelStride, other.channelStride);
+    }
+
+    //=============================================================
+    /** @Returns the number of channels */
+    int getNumChannels() const { return numChannels; }
+
+    /** @Returns the number of frames, i.e. the number of samples in each channel */
+    int64_t getNumFrames() const { return numFrames; }
+
+    /** @Returns the number of channels, so that the buffer can be used like an AudioFile<T>::AudioBuffer */
+    int size() const { return numChannels; }
+
+    //=============================================================
+    AudioChannelView<T> operator[] (int channel)
+    {
+        assert (channel >= 0 && channel < numChannels);
+        return AudioChannelView<T> (getChannelPointer (channel), numFrames);
+    }
+
+    AudioChannelView<const T> operator[] (int channel) const
+    {
+        assert (channel >= 0 && channel < numChannels);
+        return AudioChannelView<const T> (getChannelPointer (channel), numFrames);
+    }
+
+    //=============================================================
+    /** @Returns a view of every frame of the buffer */
+    AudioBufferView<T> getView() { return AudioBufferView<T> (samples, numChannels, numFrames, channelStride); }
+    AudioBufferView<const T> getView() const { return AudioBufferView<const T> (samples, numChannels, numFrames, channelStride); }
+
+    /** @Returns a view of numFrames_ frames of the buffer, starting at startFrame */
+    AudioBufferView<T> getFrames (int64_t startFrame, int64_t numFrames_) { return getView().getFrames (startFrame, numFrames_); }
+    AudioBufferView<const T> getFrames (int64_t startFrame, int64_t numFrames_) const { return getView().getFrames (startFrame, numFrames_); }
+
+private:
+
+    //=============================================================
+    /** Replaces the samples with an uninitialised block big enough for the given size */
+    void allocate (int newNumChannels, int64_t newNumFrames)
+    {
+        const int samplesPerAlignment = alignment / (int)sizeof (T);
+        int64_t newChannelStride = ((newNumFrames + samplesPerAlignment - 1) / samplesPerAlignment) * samplesPerAlignment;
+        size_t numBytes = (size_t)newNumChannels * newChannelStride * sizeof (T);
+
+        ::operator delete (allocation);
+        allocation = nullptr;
+        samples = nullptr;
+
+        if (numBytes > 0)
+        {
+            allocation = ::operator new (numBytes + alignment);
+            uintptr_t address = reinterpret_cast<uintptr_t> (allocation);
+            samples = reinterpret_cast<T*> ((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        }
+
+        numChannels = newNumChannels;
+        numFrames = newNumFrames;
+        channelStride = newChannelStride;
+    }
+
+    T* getChannelPointer (int channel) const
+    {
+        return samples + (size_t)channel * channelStride;
+    }
+
+    //=============================================================
+    void* allocation;
+    T* samples;
+    int numChannels;
+    int64_t numFrames;
+    int64_t channelStride;
+};
+
+#endif /* _AS_PlanarAudioBuffer_h */
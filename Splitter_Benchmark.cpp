@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <utility>
+#include "SampleSplitter.h"
+
+//------------------------------------------------------------
+// Compares non-live sample splitters holding the drum file as double,
+// float and int16_t: how long loading and splitting take, how much
+// memory the samples need, and that every type finds the same samples.
+// The frame by frame loop the splitter used to detect samples with is
+// timed too. Build and run from the top level directory with
+//     make benchmarks
+//     ./splitter_benchmark All_Drum_Samples.wav
+//------------------------------------------------------------
+
+using namespace std::chrono;
+
+double threshold = .1;
+double grace_time = 3;
+
+// The old detector: every frame is compared and the grace period counted
+// down one frame at a time
+template <class T>
+int split_frame_by_frame(AudioFile<T>& audioFile){
+    bool recording = false;
+    int grace_sample_num = (int) (audioFile.getSampleRate()*grace_time);
+    T sample_threshold = AudioSampleTraits<T>::fromAmplitude(threshold);
+    int64_t grace_period = 0;
+    int file_number = 1;
+    AudioChannelView<T> left = audioFile.samples[0];
+    AudioChannelView<T> right = audioFile.samples[1];
+    for (int64_t i = 0; i < audioFile.getNumSamplesPerChannel(); i++)
+    {
+        if ((left[i]>sample_threshold || right[i]>sample_threshold) && grace_period <= 0){
+            if (recording){
+                file_number++;
+            }
+            recording = true;
+            grace_period = grace_sample_num;
+        }
+        grace_period--;
+    }
+    return file_number;
+}
+
+// Runs something a few times and returns the best time in milliseconds
+template <class F>
+double best_time(F run, int repeats){
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++){
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        run();
+        duration<double, std::milli> elapsed = high_resolution_clock::now() - start;
+        if (elapsed.count() < best){
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+template <class T>
+void run_benchmark(std::string type_name, std::string file_name, const std::vector<std::pair<int64_t,int64_t>>& reference){
+    AudioFile<T> audioFile;
+    double load_time = best_time([&]() { audioFile.load (file_name); }, 5);
+    double megabytes = audioFile.getNumSamplesPerChannel() * audioFile.getNumChannels() * sizeof (T) / 1e6;
+
+    int num_samples = 0;
+    double frame_by_frame_time = best_time([&]() { num_samples = split_frame_by_frame (audioFile); }, 20);
+
+    BasicSampleSplitter<T> splitter(file_name);
+    // The splitter reports every split, which would swamp the results
+    std::cout.setstate(std::ios::failbit);
+    double split_time = best_time([&]() { splitter.split_samples (threshold, grace_time); }, 20);
+    std::cout.clear();
+
+    // Every sample type should find samples starting and ending on the same frames
+    const std::vector<std::pair<int64_t,int64_t>>& ranges = splitter.get_sample_ranges();
+    std::cout << type_name << ": " << megabytes << " MB of samples" << std::endl;
+    std::cout << "  load: " << load_time << " ms" << std::endl;
+    std::cout << "  split frame by frame: " << frame_by_frame_time << " ms, " << num_samples << " samples" << std::endl;
+    std::cout << "  split: " << split_time << " ms (" << frame_by_frame_time / split_time << "x), "
+              << ranges.size() << " samples"
+              << (ranges == reference ? "" : " MISMATCH") << std::endl;
+}
+
+// ==================== MAIN ======================
+int main(int argc, char* argv[]){
+
+std::string file_name = argc > 1 ? argv[1] : "All_Drum_Samples.wav";
+
+AudioFile<double> check;
+if (!check.load(file_name)){
+    return 1;
+}
+
+SampleSplitter reference_splitter(file_name);
+std::cout.setstate(std::ios::failbit);
+reference_splitter.split_samples(threshold, grace_time);
+std::cout.clear();
+std::vector<std::pair<int64_t,int64_t>> reference = reference_splitter.get_sample_ranges();
+
+run_benchmark<double>("double", file_name, reference);
+run_benchmark<float>("float", file_name, reference);
+run_benchmark<int16_t>("int16_t", file_name, reference);
+
+return 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <stdexcept>
+#include "elma.h"
+
+namespace elma { 
+    
+    //! Send a packet. A packet whose sequence number isn't greater than the newest
+    //! packet's is a duplicate, and is counted and dropped instead.
+    //! \param packet The packet to send into the channel
+    //! \return A reference to the channel, for chaining
+    AudioChannel& AudioChannel::send(AudioPacketPtr packet) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if ( !_queue.empty() && packet->sequence_number <= _queue.front()->sequence_number ) {
+            _duplicates++;
+            return *this;
+        }
+        _queue.push_front(std::move(packet));
+        while ( _queue.size() > capacity() ) {
+            _queue.pop_back();
+        }
+        return *this;
+    }
+
+    //! Clear the channel, deleting all packets in it
+    //! \return A reference to the channel, for chaining
+    AudioChannel& AudioChannel::flush() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _queue.clear();
+        return *this;
+    }
+
+    //! Get the newest packet.
+    //! Throws an error if the channel is empty.
+    //! \return A pointer to the packet
+    AudioPacketPtr AudioChannel::latest() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if ( _queue.size() == 0 ) {
+            throw Exception("Tried to get the latest packet in an empty audio channel.");
+        }
+        return _queue.front();
+    }
+
+    //! Get the oldest packet.
+    //! Throws an error if the channel is empty.
+    //! \return A pointer to the packet
+    AudioPacketPtr AudioChannel::earliest() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if ( _queue.size() == 0 ) {
+            throw Exception("Tried to get the earliest packet in an empty audio channel.");
+        }
+        return _queue.back();        
+    }    
+
+    //! Get a packet by its age.
+    //! Throws an error if there is no such packet.
+    //! \param index 0 for the newest packet, 1 for the one before it, and so on
+    //! \return A pointer to the packet
+    AudioPacketPtr AudioChannel::at(int index) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if ( index < 0 || index >= _queue.size() ) {
+            throw Exception("Tried to get a packet that isn't in the audio channel.");
+        }
+        return _queue[index];
+    }
+
+    //! Get every packet newer than a given one, in a single step, so a consumer on
+    //! another thread from the sender sees a consistent set of packets.
+    //! \param sequence_number The sequence number of the last packet already read
+    //! \return Pointers to the packets with larger sequence numbers, oldest first
+    vector<AudioPacketPtr> AudioChannel::newer_than(long sequence_number) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        // The newest packets are at the front, so walk forward until an old one turns up
+        int num_newer = 0;
+        while ( num_newer < _queue.size() && _queue[num_newer]->sequence_number > sequence_number ) {
+            num_newer++;
+        }
+        return vector<AudioPacketPtr>(_queue.rend() - num_newer, _queue.rend());
+    }
+
+}
@@ -0,0 +1,125 @@
+#ifndef AUDIO_CHANNEL_H
+#define AUDIO_CHANNEL_H
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+namespace elma {
+
+    using std::string;
+    using std::deque;
+    using std::vector;
+    using namespace std::chrono;
+
+    //! A block of audio frames, as sent through an AudioChannel.
+
+    //! The samples are stored as interleaved floats, so frame i of channel c is
+    //! samples[i * num_channels + c]. Floats hold 8, 16 and 24 bit PCM samples exactly.
+    struct AudioPacket {
+
+        //! Constructor
+        //! \param channels The number of audio channels in each frame
+        //! \param frames The number of frames in the packet
+        AudioPacket(int channels, int frames) : 
+          num_channels(channels), 
+          num_frames(frames), 
+          sequence_number(0),
+          timestamp(high_resolution_clock::duration::zero()), 
+          samples((size_t) channels * frames) {}
+
+        //! \param frame The index of a frame in the packet
+        //! \param channel The audio channel
+        //! \return The sample of the given channel in the given frame
+        inline float sample(int frame, int channel) const { return samples[(size_t) frame * num_channels + channel]; }
+
+        //! The number of audio channels in each frame
+        int num_channels;
+
+        //! The number of frames in the packet
+        int num_frames;
+
+        //! The position of the packet in its stream, counting up from 0.
+        //! Consumers use it to read every packet exactly once.
+        long sequence_number;
+
+        //! The time of the first frame of the packet, measured from the start of the stream
+        high_resolution_clock::duration timestamp;
+
+        //! The interleaved samples
+        vector<float> samples;
+
+    };
+
+    //! Packets are shared rather than copied, so sending one only moves a pointer
+    typedef std::shared_ptr<const AudioPacket> AudioPacketPtr;
+
+    //! A channel for sending blocks of audio to and from Process objects
+
+    //! It works like a Channel, but holds AudioPacket pointers rather than json values,
+    //! so audio can be passed between processes without converting each sample.
+    //! Every method locks the channel, so processes running on different threads
+    //! (see Manager::set_execution_mode) can share it.
+    //! Packets should be sent in sequence number order. A packet that isn't newer than
+    //! the newest one in the channel is a duplicate, such as a re-send, and is dropped
+    //! and counted rather than stored, so the packets stay in order for newer_than().
+    class AudioChannel {
+
+        public:
+
+        //! Constructor
+        //! \param name The name of the channel
+        AudioChannel(string name) : _name(name), _capacity(100), _duplicates(0) {}
+
+        //! Constructor
+        //! \param name The name of the channel
+        //! \param capacity The maximum number of packets to store in the channel
+        AudioChannel(string name, int capacity) : _name(name), _capacity(capacity), _duplicates(0) {}
+
+        AudioChannel& send(AudioPacketPtr packet);
+        AudioChannel& flush();
+        AudioPacketPtr latest();
+        AudioPacketPtr earliest();
+        AudioPacketPtr at(int index);
+        vector<AudioPacketPtr> newer_than(long sequence_number);
+
+        //! Getter
+        //! \return The number of packets in the channel
+        inline int size() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size(); }
+
+        //! Getter
+        //! \return Whether the channel is empty      
+        inline bool empty() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size() == 0; }
+
+        //! Getter
+        //! \return Whether the channel is not empty
+        inline bool nonempty() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size() > 0; }
+
+        //! Getter
+        //! \return The name of the channel      
+        inline string name() { return _name; }
+
+        //! Getter
+        //! \return The capacity of the channel      
+        inline int capacity() { return _capacity; }
+
+        //! Getter
+        //! \return The number of packets dropped by send() because they weren't newer than the newest packet
+        inline long duplicates() { std::lock_guard<std::mutex> lock(_mtx); return _duplicates; }
+
+        private:
+
+        string _name;
+        int _capacity;
+        long _duplicates;
+        deque<AudioPacketPtr> _queue;
+        std::mutex _mtx;
+
+    };
+
+}
+
+#endif
@@ -8,6 +8,7 @@ namespace elma {
     //! \param value The value to send into the channel
     //! \return A reference to the channel, for chaining
     Channel& Channel::send(json value) {
+        std::lock_guard<std::mutex> lock(_mtx);
         _queue.push_front(value);
         while ( _queue.size() > capacity() ) {
             _queue.pop_back();
@@ -18,6 +19,7 @@ namespace elma {
     //! Clear the channel, deleting all values in it
     //! \return A reference to the channel, for chaining
     Channel& Channel::flush() {
+        std::lock_guard<std::mutex> lock(_mtx);
         _queue.clear();
         return *this;
     }
@@ -26,6 +28,7 @@ namespace elma {
     //! Throws an error if the channel is empty.
     //! \return A reference to the channel, for chaining
     json Channel::latest() {
+        std::lock_guard<std::mutex> lock(_mtx);
         if ( _queue.size() == 0 ) {
             throw Exception("Tried to get the latest value in an empty channel.");
         }
@@ -36,6 +39,7 @@ namespace elma {
     //! Throws an error if the channel is empty.
     //! \return A reference to the channel, for chaining
     json Channel::earliest() {
+        std::lock_guard<std::mutex> lock(_mtx);
         if ( _queue.size() == 0 ) {
             throw Exception("Tried to get the earliest value in an empty channel.");
         }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <deque>
+#include <mutex>
 #include <json/json.h>
 
 #include "elma.h"
@@ -18,6 +19,9 @@ namespace elma {
     //! Here is an example that uses channels that enables a model of a car and
     //! a simple cruise controller to communicate.
     //! \include examples/feedback.cc
+    //!
+    //! Every method locks the channel, so processes running on different threads
+    //! (see Manager::set_execution_mode) can share it.
     class Channel {
 
         public:
@@ -38,15 +42,15 @@ namespace elma {
 
         //! Getter
         //! \return The number of values in the channel
-        inline int size() { return _queue.size(); }
+        inline int size() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size(); }
 
         //! Getter
         //! \return Whether the channel is empty      
-        inline bool empty() { return _queue.size() == 0; }
+        inline bool empty() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size() == 0; }
 
         //! Getter
         //! \return Whether the channel is not empty
-        inline bool nonempty() { return _queue.size() > 0; }
+        inline bool nonempty() { std::lock_guard<std::mutex> lock(_mtx); return _queue.size() > 0; }
 
         //! Getter
         //! \return The name of the channel      
@@ -61,6 +65,7 @@ namespace elma {
         string _name;
         int _capacity;
         deque<json> _queue;
+        std::mutex _mtx;
 
     };
 
@@ -4,22 +4,34 @@
 #include <thread>
 #include <tuple>
 #include <iostream>
+#include <algorithm>
 #include "json/json.h"
-using nlohmann::json; 
+using nlohmann::json;
 
 namespace elma {
 
+    Client::Client(int num_threads, int queue_capacity) :
+      _num_threads(std::max(num_threads, 1)),
+      _queue_capacity(std::max(queue_capacity, 1)),
+      _stopping(false) {}
+
+    Client::~Client() {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _stopping = true;
+        }
+        _work_available.notify_all();
+        for ( auto& thread : _threads ) {
+            thread.join();
+        }
+    }
 
     std::pair<std::string,std::string> Client::url_parts(std::string url) {
-        
+
         std::string protocol = url.substr(0,url.find("://"));
-        if ( protocol == "http" ) {
-            _use_ssl = false;
-        } else if ( protocol == "https" ) {
-            _use_ssl = true;
-        } else {
+        if ( protocol != "http" && protocol != "https" ) {
             throw Exception("Protocol " + protocol + " not implemented in Client.");
-        } 
+        }
 
         std::string rest = url.substr(protocol.length() + 3),
                     addr = rest.substr(0, rest.find("/")),
@@ -34,129 +46,175 @@ namespace elma {
     }
 
     Client& Client::get(std::string url, std::function<void(json&)> handler) {
-        std::thread t(&Client::_get_thread,this,url,handler);
-        t.detach(); // detaching means we don't have to join later
+        return _send({ GET, url, json(), handler, std::chrono::steady_clock::now() });
     }
 
     Client& Client::post(std::string url, json data, std::function<void(json&)> handler) {
-        // TODO: problem 2
-        // Use httplib post
-        //cli.Post(const char* path, const std::string& body, const char* content_type);
-        std::thread t(&Client::_post_thread,this,url,data,handler);
-        t.detach(); 
-        
-
+        return _send({ POST, url, data, handler, std::chrono::steady_clock::now() });
     }
 
     Client& Client::process_responses() {
 
-        _mtx.lock();
+        // Handlers run without the lock, so they can make more requests
+        std::vector<std::tuple<json, std::function<void(json&)>>> responses;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            responses.swap(_responses);
+        }
 
-        for(auto response : _responses ) {
+        for(auto& response : responses ) {
             std::get<1>(response)(std::get<0>(response));
         }
 
-        _responses.clear();
-
-        _mtx.unlock();
-
         return *this;
 
     }
 
-    const std::shared_ptr<httplib::Response> Client::_get_aux(std::string url) {
-        auto parts = url_parts(url);
-        if ( _use_ssl ) {
-            httplib::SSLClient cli(parts.first.c_str(), 443);
-            return cli.Get(parts.second.c_str());              
-        } else {
-            httplib::Client cli(parts.first.c_str(), 80);
-            return cli.Get(parts.second.c_str());              
-        }        
+    // Queue a request for the workers, starting them if this is the first one
+    Client& Client::_send(Request request) {
+
+        url_parts(request.url); // throws now, rather than on a worker, if the protocol is unknown
+
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        if ( (int) _queue.size() >= _queue_capacity ) {
+            std::cout << "Warning: Elma client is too busy, dropping a request to "
+                      << request.url
+                      << std::endl;
+            _stats.requests_rejected++;
+            _responses.push_back(std::make_tuple(json(), request.handler));
+            return *this;
+        }
+
+        if ( _threads.empty() ) {
+            for ( int i = 0; i < _num_threads; i++ ) {
+                _threads.push_back(std::thread(&Client::_worker, this));
+            }
+        }
+
+        _queue.push_back(std::move(request));
+        _stats.requests_sent++;
+        _stats.in_flight++;
+        _work_available.notify_one();
+
+        return *this;
+
     }
 
-    void Client::_get_thread(std::string url, std::function<void(json&)> handler) {
+    // Send queued requests until the client is destroyed. Each worker keeps its own
+    // connection to each host it has talked to.
+    void Client::_worker() {
 
-        json json_response;
+        std::map<std::string, Connection> connections;
+        std::unique_lock<std::mutex> lock(_mtx);
 
-        try {
-            auto response = _get_aux(url);
+        while ( true ) {
 
-            if (response && response->status == 200) {
-                json_response = json::parse(response->body);
-             } else if ( response ) {
-                std::cout << "Warning:: Elma client connected to a server that returned Error: " 
-                          << response->status 
-                          << std::endl;
+            _work_available.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+            // When the client is destroyed, the requests still queued are sent before the workers stop
+            if ( _queue.empty() ) {
+                return;
+            }
+            Request request = std::move(_queue.front());
+            _queue.pop_front();
+
+            lock.unlock();
+            bool completed;
+            json json_response = _perform(connections, request, completed);
+            double latency = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - request.sent).count();
+            lock.lock();
+
+            if ( completed ) {
+                _stats.requests_completed++;
             } else {
-                std::cout << "Warning:: Elma client returned no result" 
-                          << std::endl;
+                _stats.requests_failed++;
             }
+            _stats.in_flight--;
+            long finished = _stats.requests_completed + _stats.requests_failed;
+            _stats.mean_latency_ms += (latency - _stats.mean_latency_ms) / finished;
+            _stats.max_latency_ms = std::max(_stats.max_latency_ms, latency);
+            _responses.push_back(std::make_tuple(json_response, request.handler));
 
-        } catch (const httplib::Exception& e) {
-            std::cout << "Warning: Elma client failed: " 
-                      << e.what() 
-                      << "\n";
-        } catch(const json::exception& e ) {
-            std::cout << "Warning: Elma client could not parse response: " 
-                      << e.what() 
-                      << "\n";
-        } catch (...) {
-            std::cout << "Warning: Elma client failed with no message\n";
         }
 
-        _mtx.lock();
-        _responses.push_back(std::make_tuple(json_response, handler));
-        _mtx.unlock();
-
-    }    
-
-    // My functions for Post
-    const std::shared_ptr<httplib::Response> Client::_post_aux(std::string url, json data) {
-        auto parts = url_parts(url);
-        if ( _use_ssl ) {
-            httplib::SSLClient cli(parts.first.c_str(), 443);
-            return cli.Post(parts.second.c_str(), data.dump(), "json");              
-        } else {
-            httplib::Client cli(parts.first.c_str(), 80);
-            return cli.Post(parts.second.c_str(), data.dump(), "json");              
-        }        
     }
 
-    void Client::_post_thread(std::string url, json data, std::function<void(json&)> handler) {
+    // Send a request on the worker's connection to its host, opening one if needed
+    json Client::_perform(std::map<std::string, Connection>& connections, const Request& request, bool& completed) {
 
         json json_response;
+        bool ssl = request.url.compare(0, 8, "https://") == 0;
+        auto parts = url_parts(request.url);
+        std::string key = (ssl ? "https://" : "http://") + parts.first;
+        completed = false;
 
         try {
-            auto response = _post_aux(url, data);
+
+            // The address may name a port, as in localhost:8080
+            std::string host = parts.first;
+            int port = ssl ? 443 : 80;
+            size_t colon = host.find(':');
+            if ( colon != std::string::npos ) {
+                port = std::stoi(host.substr(colon + 1));
+                host = host.substr(0, colon);
+            }
+
+            Connection& connection = connections[key];
+            std::shared_ptr<httplib::Response> response;
+
+            if ( ssl ) {
+                if ( !connection.https ) {
+                    connection.https.reset(new httplib::SSLClient(host.c_str(), port));
+                    connection.https->set_keep_alive(true);
+                }
+                response = request.method == GET
+                         ? connection.https->Get(parts.second.c_str())
+                         : connection.https->Post(parts.second.c_str(), request.data.dump(), "json");
+            } else {
+                if ( !connection.http ) {
+                    connection.http.reset(new httplib::Client(host.c_str(), port));
+                    connection.http->set_keep_alive(true);
+                }
+                response = request.method == GET
+                         ? connection.http->Get(parts.second.c_str())
+                         : connection.http->Post(parts.second.c_str(), request.data.dump(), "json");
+            }
+
+            if ( response ) {
+                completed = true;
+            } else {
+                // The connection may have been closed by the server, so start afresh next time
+                connections.erase(key);
+            }
 
             if (response && response->status == 200) {
                 json_response = json::parse(response->body);
              } else if ( response ) {
-                std::cout << "Warning:: Elma client connected to a server that returned Error: " 
-                          << response->status 
+                std::cout << "Warning:: Elma client connected to a server that returned Error: "
+                          << response->status
                           << std::endl;
             } else {
-                std::cout << "Warning:: Elma client returned no result" 
+                std::cout << "Warning:: Elma client returned no result"
                           << std::endl;
             }
 
         } catch (const httplib::Exception& e) {
-            std::cout << "Warning: Elma client failed: " 
-                      << e.what() 
+            connections.erase(key);
+            std::cout << "Warning: Elma client failed: "
+                      << e.what()
                       << "\n";
         } catch(const json::exception& e ) {
-            std::cout << "Warning: Elma client could not parse response: " 
-                      << e.what() 
+            std::cout << "Warning: Elma client could not parse response: "
+                      << e.what()
                       << "\n";
         } catch (...) {
+            connections.erase(key);
             std::cout << "Warning: Elma client failed with no message\n";
         }
 
-        _mtx.lock();
-        _responses.push_back(std::make_tuple(json_response, handler));
-        _mtx.unlock();
+        return json_response;
 
-    }    
+    }
 
-};
\ No newline at end of file
+};
@@ -6,14 +6,46 @@
 
 #include <string>
 #include <tuple>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
 #include "elma.h"
 #include "json/json.h"
 using nlohmann::json; 
 
 namespace elma {
 
+    //! How a Client has kept up with the requests given to it.
+    struct ClientStats {
+        //! The number of requests accepted by get() and post().
+        long requests_sent = 0;
+        //! The number of requests that got a response from the server, whatever its status.
+        long requests_completed = 0;
+        //! The number of requests that failed to connect, or got no response.
+        long requests_failed = 0;
+        //! The number of requests turned away because the queue was full.
+        long requests_rejected = 0;
+        //! The number of requests queued or being sent right now.
+        int in_flight = 0;
+        //! The average time from get() or post() to the response arriving, in milliseconds.
+        double mean_latency_ms = 0;
+        //! The longest time from get() or post() to the response arriving, in milliseconds.
+        double max_latency_ms = 0;
+    };
+
     //! An HTTP client for connecting to json services
 
+    //! Requests are queued and sent by a fixed number of worker threads, which start
+    //! when the first request is made. Each worker keeps its connection to each host
+    //! open between requests, so a burst of requests to the same service doesn't make
+    //! a burst of threads and handshakes. If the queue is full, a request is turned
+    //! away and its handler gets an empty response, just as if the request had failed.
+    //!
     //! An example usage in a process
     //! @code
     //! class GetTester : public Process {
@@ -39,20 +71,37 @@ namespace elma {
 
         //! Construct a new client. Only the Manager would normall do this, although
         //! a client can work as a standalone object.
-        Client() : _use_ssl(false) {}
+        //! \param num_threads The number of worker threads sending requests
+        //! \param queue_capacity The number of requests that can wait for a worker
+        Client(int num_threads = 2, int queue_capacity = 64);
+
+        //! Stops the workers once they have sent every request still queued. The responses
+        //! to those requests are dropped without calling their handlers, since the client
+        //! won't be around to process them, and the processes whose handlers they are may
+        //! already be gone.
+        ~Client();
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
 
         //! Send an HTTP GET request to a specific URL and register a handler 
         //! to deal with the response. This method assumes the server will respond
         //! with a JSON string. This method is asynchronous and returns immediately.
-        //! \param url The url, preceded by http:// or https://
+        //! \param url The url, preceded by http:// or https://, whose address may include a port
         //! \param handler The handler, whose argument will be the json received from the request
         //! \return A reference to the client, for chaining
         Client& get(std::string url, std::function<void(json&)> handler);
 
-        // Problem 2
+        //! Send an HTTP POST request with a json body to a specific URL and register a handler 
+        //! to deal with the response. This method is asynchronous and returns immediately.
+        //! \param url The url, preceded by http:// or https://
+        //! \param data The json to send
+        //! \param handler The handler, whose argument will be the json received from the request
+        //! \return A reference to the client, for chaining
         Client& post(std::string url, json data, std::function<void(json&)> handler);
 
-        //! Process all responses received so far
+        //! Process all responses received so far. Handlers are called on the calling
+        //! thread, and may make more requests.
         //! \return A reference to the client, for chaining        
         Client& process_responses();
 
@@ -62,20 +111,41 @@ namespace elma {
         std::pair<std::string,std::string> url_parts(std::string url);
 
         //! \return The number of unprocessed responses
-        int num_responses() const { return _responses.size(); }
+        int num_responses() { std::lock_guard<std::mutex> lock(_mtx); return _responses.size(); }
+
+        //! \return How the client has kept up with its requests so far
+        ClientStats stats() { std::lock_guard<std::mutex> lock(_mtx); return _stats; }
 
         private:
 
-        // add any helper function you need
-        void _get_thread(std::string url, std::function<void(json&)> handler);
-        const std::shared_ptr<httplib::Response> _get_aux(std::string url);
+        typedef enum { GET, POST } method_type;
+
+        struct Request {
+            method_type method;
+            std::string url;
+            json data;
+            std::function<void(json&)> handler;
+            std::chrono::steady_clock::time_point sent;
+        };
+
+        // A worker's open connection to one host. Only one of the two is used.
+        struct Connection {
+            std::unique_ptr<httplib::Client> http;
+            std::unique_ptr<httplib::SSLClient> https;
+        };
+
+        Client& _send(Request request);
+        void _worker();
+        json _perform(std::map<std::string, Connection>& connections, const Request& request, bool& completed);
+
+        int _num_threads, _queue_capacity;
+        std::vector<std::thread> _threads;
+        std::deque<Request> _queue;
+        std::condition_variable _work_available;
+        bool _stopping;
+        ClientStats _stats;
         std::vector<std::tuple<json, std::function<void(json&)>>> _responses;
-        bool _use_ssl;
-        std::mutex _mtx;
-
-        // My post functions
-        void _post_thread(std::string url, json data, std::function<void(json&)> handler);
-        const std::shared_ptr<httplib::Response> _post_aux(std::string url, json data);
+        std::mutex _mtx;   // for the queue, the responses and the stats
 
     };
 
@@ -4,15 +4,19 @@
 // Utilities
 #include "literals.h"
 #include "exceptions.h"
+#include "trace.h"
 
 // Communications
 #include "channel.h"
+#include "audio_channel.h"
+#include "typed_channel.h"
 #include "event.h"
 
 // HTTP
 #include "client.h"
 
 // Processes
+#include "process_stats.h"
 #include "process.h"
 #include "manager.h"
 
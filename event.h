@@ -38,7 +38,7 @@ namespace elma {
         inline bool empty() const { return _empty; }        
 
         //! \return Whether the event has no data
-        inline std::string name() const { return _name; }        
+        inline const std::string& name() const { return _name; }        
 
         //! Determine whether the event will propagate to the next event handler
         //! \return True or false
@@ -19,7 +19,7 @@
 using namespace std;
 using namespace elma;
 
-//! Reads .wav file and sends audio data packets in left and right channels, 1 json array per update.
+//! Reads .wav file and sends audio data packets through the "audio" audio channel, 1 packet per update.
 //! Its purpose is to simulate an audio recording device, streaming live.
 class LiveRecordingSimulator : public Process {
 
@@ -37,24 +37,28 @@ class LiveRecordingSimulator : public Process {
         split_audio_into_packets();
     };
 
-    void init() {}
-    //! Tells the manager its bit depth and sample rate when initialized.
+    //! Finds the audio channel and its events once, so they aren't looked up by name as it runs.
+    void init() {
+        audio = &audio_channel("audio");
+        bit_depth_event = event_id("set bit depth");
+        sample_rate_event = event_id("set sample rate");
+    }
+    //! Tells the manager its bit depth and sample rate when started.
     void start() {
-        emit(Event("set bit depth", bit_depth));
-        emit(Event("set sample rate", sample_rate));
+        emit(bit_depth_event, Event("set bit depth", bit_depth));
+        emit(sample_rate_event, Event("set sample rate", sample_rate));
     }
-    //! Every update sends the next json audio data packet through the left and right channels.
+    //! Every update sends the next audio data packet through the audio channel.
+    //! The packets are shared, so sending one doesn't copy its audio.
     void update() {
-        if (i < left_data_packets.size()){
-            channel("left audio").send(left_data_packets[i]);
-            channel("right audio").send(right_data_packets[i]);
+        if (i < data_packets.size()){
+            audio->send(data_packets[i]);
             i++;
         }
     }
     void stop() {}
 
-    //! Splits the audio data from the .wav file into buffer sized packets.
-    //! Converts the data packets to json and adds them to an array of json packets. 
+    //! Splits the audio data from the .wav file into buffer sized packets of interleaved frames.
     void split_audio_into_packets();
 
     private:
@@ -63,37 +67,32 @@ class LiveRecordingSimulator : public Process {
     AudioFile<double> audioFile;
     double bit_depth;
     double sample_rate;
-    vector<json> left_data_packets;
-    vector<json> right_data_packets;
+    vector<AudioPacketPtr> data_packets;
+    //! The channel the packets are sent through, found in init().
+    AudioChannel* audio = nullptr;
+    //! The ids of the events sent when started, found in init().
+    int bit_depth_event, sample_rate_event;
     //! User defined buffer size.
     int bs;
 };
 
 void LiveRecordingSimulator::split_audio_into_packets(){
 
-    int buffer_size_counter = 0;
-    json left_buffer;
-    json right_buffer;
+    int num_channels = audioFile.getNumChannels();
+    int64_t num_frames = audioFile.getNumSamplesPerChannel();
 
-    for (int i = 0; i < audioFile.getNumSamplesPerChannel(); i++){
-        if(buffer_size_counter < bs){
-            left_buffer.push_back(audioFile.samples[0][i]);
-            right_buffer.push_back(audioFile.samples[1][i]);
-            buffer_size_counter++;
-        } else {
-            left_data_packets.push_back(left_buffer);
-            right_data_packets.push_back(right_buffer);
-            left_buffer.clear();
-            right_buffer.clear();
-            buffer_size_counter = 0;
+    for (int64_t start = 0; start < num_frames; start += bs){
+        int packet_frames = (int) std::min((int64_t) bs, num_frames - start);
+        std::shared_ptr<AudioPacket> packet = std::make_shared<AudioPacket>(num_channels, packet_frames);
+        packet->sequence_number = data_packets.size();
+        packet->timestamp = duration_cast<high_resolution_clock::duration>(duration<double>(start / sample_rate));
+        for (int channel = 0; channel < num_channels; channel++){
+            AudioChannelView<double> samples = audioFile.samples[channel];
+            for (int i = 0; i < packet_frames; i++){
+                packet->samples[(size_t) i * num_channels + channel] = (float) samples[start + i];
+            }
         }
+        data_packets.push_back(packet);
     }
 
-    // Add the last data packet
-    left_data_packets.push_back(left_buffer);
-    right_data_packets.push_back(right_buffer);
-    left_buffer.clear();
-    right_buffer.clear();
-    buffer_size_counter = 0;
-
-}
\ No newline at end of file
+}
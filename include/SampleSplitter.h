@@ -12,15 +12,34 @@
 #include <math.h>
 #include <stdio.h>
 #include "AudioFile.h"
+#include "AudioRingBuffer.h"
+#include "ExportPool.h"
 #include "channel.h"
 #include <fstream>
 #include <vector>
+#include <memory>
 
 using namespace std;
 using namespace elma;
 
+//! What live mode does when the sample being recorded outgrows the backlog.
+enum class BacklogOverflow {
+    //! Drops the oldest frames of the sample, so the exported sample loses its start.
+    DropOldest,
+    //! Starts writing the sample to its file early, so the whole sample is still exported.
+    Spill
+};
+
 //! Takes audio data, splits it and exports it as several audio samples.
-class SampleSplitter : public Process {
+
+//! Samples are held as T, which can be double, float, int16_t or int32_t: the .wav file in
+//! non-live mode, and the backlog and the samples waiting to be written in live mode. Thresholds
+//! are still given as amplitudes from -1 to 1, and are converted to T once so samples are compared
+//! in their own type. Live audio is converted to T as each packet is read. An int16_t splitter
+//! keeps 16-bit files bit exact, in a quarter of the memory of a double one.
+//! Most code uses SampleSplitter, which holds samples as double.
+template <class T>
+class BasicSampleSplitter : public Process {
 
     public:
     //! The live mode instantiator.
@@ -29,50 +48,101 @@ class SampleSplitter : public Process {
     //! \param threshold The minimum amplitude that must be surpased to start recording a single sample.
     //! \param grace_time The minimum amount of time after one sample begins recording before another can start to be recorded.
     //! \param updates_per_export_attempt The number of updates between each attempt to export a sample.
-    SampleSplitter(double threshold, double grace_time, double updates_per_export_attempt):Process("sample splitter") {
+    //! Samples are written to disk by a pool of export threads, so updates never wait on the disk. Each attempt
+    //! hands the pool the part of the sample being recorded that it has scanned, a block at a time, so an update
+    //! only ever scans and copies the audio that arrived since the last attempt, however long the samples are.
+    //! \param overflow What to do when a sample being recorded outgrows the backlog.
+    //! \param export_threads The number of threads writing samples to disk.
+    //! \param export_queue_capacity The number of blocks of audio each export thread can have waiting before the splitter has to wait for it.
+    BasicSampleSplitter(double threshold, double grace_time, double updates_per_export_attempt,
+                   BacklogOverflow overflow = BacklogOverflow::Spill,
+                   int export_threads = 2, int export_queue_capacity = 8):Process("sample splitter") {
         upea = updates_per_export_attempt;
         th = threshold;
         gt = grace_time;
-        backlog.resize (2);
+        overflow_policy = overflow;
+        export_pool.reset(new ExportPool<T>(export_threads, export_queue_capacity));
         live = true;
     };
     //! The non-live mode instantiator
     //! Use this instantiator if you wish to use the sample splitter to split a pre recorded .wav file.
     //! \param filename The .wav file to be read.
-    SampleSplitter(std::string filename):Process("sample splitter") 
+    BasicSampleSplitter(std::string filename):Process("sample splitter") 
     {
         audioFile.load (filename);
         live = false;
     };
+    //! The streaming non-live mode instantiator
+    //! Use this instantiator if you wish to split a pre recorded .wav file that is too large to hold in memory.
+    //! The file is not loaded up front. Instead it is read block_size frames at a time whenever it is split or exported,
+    //! so only the sample being exported is ever held in memory. Only the file's header is read here, and exporting or
+    //! previewing a sample seeks straight to it, so it costs the length of the sample rather than of the file.
+    //! \param filename The .wav file to be read.
+    //! \param block_size The number of frames read from the file at a time.
+    BasicSampleSplitter(std::string filename, int block_size):Process("sample splitter") 
+    {
+        audioFile.load (filename, AudioFileLoadMode::HeaderOnly);
+        stream_filename = filename;
+        stream_block_size = block_size;
+        streaming = true;
+        live = false;
+    };
+    //! In live mode, deletes the file of a sample that was still being recorded, if some of it had already been written.
+    ~BasicSampleSplitter() {
+        if (export_pool && live_export_started){
+            ExportJob<T> job;
+            job.file_name = "sample_" + std::to_string(export_number) + ".wav";
+            job.cancel = true;
+            export_pool->submit(export_number, std::move(job));
+        }
+    }
 
-    //! Listens to the manager for its bit depth and sample rate when initialized.
+    //! Listens to the manager for its bit depth and sample rate when initialized,
+    //! and finds the audio channel once so updates don't look it up by name.
     void init() {
+        audio = &audio_channel("audio");
         watch("set bit depth", [this](Event& e) {
             bit_depth = e.value();
         });
         watch("set sample rate", [this](Event& e) {
             sample_rate = e.value();
+            allocate_backlog();
         });
     }
     void start() {}
 
-    //! Every update recieves the next json audio data packet through the left and right channels.
-    //! Reads the json audio packet.
+    //! Every update recieves the audio data packets sent through the audio channel since the last update.
+    //! Reads every unread packet in order, so the splitter can be updated less often than the recording.
     //! Attempts to export a sample if the grace time and the user defined number updates since the last attempt has been surpassed.
     void update() {
         
-        if ( channel("left audio").nonempty() && channel("right audio").nonempty() ) {
+        if ( audio->nonempty() ) {
 
-            read_data_packet(channel("left audio").latest(), channel("right audio").latest());
+            read_unread_packets(*audio);
             
-            if (backlog[0].size() > (int) (gt*sample_rate) && upea_counter > upea){
+            if (backlog.getNumReady() > (int) (gt*sample_rate) && upea_counter > upea){
                 attempt_live_export(th, gt);
                 upea_counter = 0;
             }
             upea_counter++;
         }
     }
-    void stop() {}
+    //! Waits for every sample to be written, then reports how the export threads kept up
+    //! and any packets that were missed or sent twice.
+    void stop() {
+        if (export_pool){
+            export_pool->flush();
+            ExportStats stats = export_pool->stats();
+            if (stats.times_blocked > 0 || stats.failed_files > 0){
+                std::cout << "Waited on the export threads " << stats.times_blocked << " times for "
+                          << stats.time_blocked_ms << " ms. " << stats.failed_files << " samples failed to export." << std::endl;
+            }
+        }
+        if (missed_packets > 0 || get_duplicate_packets() > 0){
+            std::cout << "Missed " << missed_packets << " audio packets and ignored "
+                      << get_duplicate_packets() << " duplicates." << std::endl;
+        }
+    }
     
     //! \param threshold The minimum amplitude that must be surpased to start recording a single sample.
     void set_threshold(double threshold);
@@ -107,6 +177,19 @@ class SampleSplitter : public Process {
     //! \param file_name The title the user wishes name the .wav sample file export.
     void export_sample(double sample_number, std::string file_name);
 
+    //! For non-live mode use only.
+    //! Should only be called after the .wav file has been split.
+    //! Reads the start of a stored sample, e.g. to listen to a split point before exporting. In streaming mode
+    //! only these frames are read from the file.
+    //! \param sample_number The 1 based index of the sample the user wishes to preview.
+    //! \param seconds How much of the start of the sample to read. The whole sample is read if it is shorter.
+    //! \param frames Where the frames are read to. It is resized to the number of frames read.
+    void preview_sample(double sample_number, double seconds, PlanarAudioBuffer<T>& frames);
+
+    //! For non-live mode use only.
+    //! \return The first frame and number of frames of each sample found by the last split.
+    const vector<std::pair<int64_t,int64_t>>& get_sample_ranges();
+
     //! For non-live mode use only.
     //! Should only be called after the .wav file has been split.
     //! Exports all stored samples and names them sample_1, sample_2, etc.
@@ -132,12 +215,32 @@ class SampleSplitter : public Process {
 
     //! For live mode use only.
     //! Reads the json data from the audio channels and saves it to a backlog.
+    //! If the backlog is full, the overflow policy decides what happens to the oldest frames.
     //! \param left_data The left speaker audio data in json form.
     //! \param right_data The right speaker audio data in json form.
-    void read_data_packet(json left_data, json right_data);
+    void read_data_packet(const json& left_data, const json& right_data);
+
+    //! For live mode use only.
+    //! Reads an audio packet from the audio channel and saves it to a backlog.
+    //! If the backlog is full, the overflow policy decides what happens to the oldest frames.
+    //! \param packet The packet. A mono packet is used for both the left and right speakers.
+    void read_audio_packet(const AudioPacket& packet);
+
+    //! For live mode use only.
+    //! \return The number of frames dropped so far because the backlog was full.
+    int get_dropped_frames();
+
+    //! For live mode use only.
+    //! \return The number of packets that were never read, because they left the audio channel first.
+    long get_missed_packets();
+
+    //! For live mode use only.
+    //! \return The number of packets the audio channel dropped because they had already been sent. See AudioChannel::duplicates.
+    long get_duplicate_packets();
 
     //! For live mode use only.
     //! Attempts to export a sample from the backlog.
+    //! Only the frames that have arrived since the last attempt are scanned, as the detector picks up where it left off.
     //! If it does export a sample, the left over data is kept in the backlog to be used in the next sample.
     //! \param threshold The minimum amplitude that must be surpased to start recording a single sample.
     //! \param grace_time The minimum amount of time after one sample begins recording before another can start to be recorded.
@@ -149,9 +252,9 @@ class SampleSplitter : public Process {
     //! Is the sample splitter in live mode?
     bool live;
 
-    double bit_depth;
+    double bit_depth = 16;
 
-    double sample_rate;
+    double sample_rate = 44100;
 
     //! Updates per export attempt.
     int upea;
@@ -166,221 +269,364 @@ class SampleSplitter : public Process {
     double gt = 0;
 
     //! The saved audio data, waiting to be exported.
-    AudioFile<double>::AudioBuffer backlog;
+    //! It has a fixed capacity, allocated once the sample rate is known, so memory stays flat however long the session runs.
+    AudioRingBuffer<T> backlog;
+
+    //! The audio channel packets are read from in live mode, found in init().
+    AudioChannel* audio = nullptr;
+
+    //! What to do when the sample being recorded outgrows the backlog.
+    BacklogOverflow overflow_policy = BacklogOverflow::Spill;
+
+    //! A packet is converted into these before being written to the backlog.
+    vector<T> packet_left, packet_right;
+
+    //! The number of frames dropped because the backlog was full.
+    int dropped_frames = 0;
 
-    AudioFile<double> audioFile;
+    //! Encodes and writes the samples exported in live mode on background threads.
+    std::unique_ptr<ExportPool<T>> export_pool;
 
-    //! The list of samples waiting to be exported in non-live mode.
-    vector<AudioFile<double>::AudioBuffer> sample_list;
+    //! Has any of the sample being exported in live mode been sent to the export pool yet?
+    //! This happens as soon as a block of it has been scanned, or if it spills out of the backlog.
+    bool live_export_started = false;
+
+    //! The number of frames of the sample being recorded in live mode that are sent to the export pool at a time.
+    int export_block_frames = 8192;
+
+    //! The sequence number of the last audio packet read.
+    long last_sequence_number = -1;
+
+    //! The number of audio packets that were never read.
+    long missed_packets = 0;
+
+    //! The first backlog frame that hasn't been scanned for a trigger yet.
+    int scan_cursor = 0;
+
+    //! Is a sample being recorded in live mode?
+    bool live_recording = false;
+
+    //! Grace samples left to be counted down in live mode.
+    int live_grace_period = 0;
+
+    //! The backlog frame that the sample being recorded in live mode starts at.
+    int live_sample_start = 0;
+
+    //! The .wav file in non-live mode, or just its header in streaming mode.
+    AudioFile<T> audioFile;
 
     //! Keeps track of sample number for naming exports.
     int export_number = 1;
+
+    //! Is the sample splitter reading its .wav file from disk as it goes?
+    bool streaming = false;
+
+    //! The .wav file read in streaming mode.
+    std::string stream_filename;
+
+    //! The number of frames read from the .wav file at a time in streaming mode.
+    int stream_block_size = 0;
+
+    //! The samples waiting to be exported in non-live mode, as the first frame and number of frames of each one.
+    //! Samples are exported straight from these ranges of the file, so splitting doesn't copy any audio.
+    vector<std::pair<int64_t,int64_t>> sample_ranges;
+
+    //! \return The number of samples found by the last split.
+    int num_split_samples();
+
+    //! Splits the .wav file in streaming mode, recording where each sample starts and how long it is.
+    void split_samples_streaming(double threshold, double grace_time);
+
+    //! How far the detector has got, so a file can be scanned in one go or a block at a time, and the live backlog as it fills.
+    struct SplitState {
+        //! Is a sample being recorded?
+        bool recording = false;
+        //! Grace samples to be counted down.
+        int64_t grace_period = 0;
+        //! The first frame of the sample being recorded.
+        int64_t sample_start = 0;
+        //! The number of samples found so far, counting the one being recorded.
+        int file_number = 1;
+    };
+
+    //! Runs the detector over num_frames frames of the left and right channels, which start at
+    //! first_frame in the file or the backlog, calling on_sample(start, num_frames) for each sample that ends in them.
+    //! No sample can start while the grace period counts down, so those frames are skipped without being read.
+    template <class F>
+    void split_frames(const T* left, const T* right, int64_t first_frame, int64_t num_frames,
+                      T threshold, int64_t grace_sample_num, SplitState& state, F on_sample);
+
+    //! \return The first frame from begin up to end where either channel is over the threshold, or end if there isn't one.
+    //! The frames are compared a block at a time without branching, so the compiler can compare several at once,
+    //! twice as many for float samples as for double.
+    static int64_t find_frame_over(const T* left, const T* right, int64_t begin, int64_t end, T threshold);
+
+    //! Allocates the live backlog, with room for four grace times of audio or at least a second.
+    void allocate_backlog();
+
+    //! Reads the packets in the audio channel that are newer than the last one read, oldest first,
+    //! counting any packets missed along the way.
+    void read_unread_packets(AudioChannel& audio);
+
+    //! Writes the num_frames frames of packet_left and packet_right to the live backlog.
+    void append_packet_to_backlog(int num_frames);
+
+    //! Makes room for num_frames more frames in the live backlog, applying the overflow policy if needed.
+    void make_backlog_room(int num_frames);
+
+    //! Copies backlog frames into a job for the export pool, which appends them to the sample being exported.
+    //! \param last Are these the last frames of the sample?
+    void write_backlog_frames(int start, int num_frames, bool last);
+
+    //! Frees the oldest num_frames frames of the backlog.
+    void discard_backlog(int num_frames);
     
 };
 
+//! A sample splitter holding samples as double.
+typedef BasicSampleSplitter<double> SampleSplitter;
 
 
-void SampleSplitter::set_threshold(double threshold){
+
+template <class T>
+void BasicSampleSplitter<T>::set_threshold(double threshold){
     th = threshold;
 }
 
-void SampleSplitter::set_grace_time(double grace_time){
+template <class T>
+void BasicSampleSplitter<T>::set_grace_time(double grace_time){
     gt = grace_time;
 }
 
 // --------- non-live mode functions -------------------------------------------------------------------
-double SampleSplitter::number_of_samples(){
+template <class T>
+double BasicSampleSplitter<T>::number_of_samples(){
     if(live){
         std::cout << "Can't find number of samples in live mode." <<std::endl;
+        return 0;
     } else{
-        return sample_list.size();
+        return num_split_samples();
     }
 }
 
-double SampleSplitter::get_max(){
+template <class T>
+double BasicSampleSplitter<T>::get_max(){
     if(live){
         std::cout << "Can't find max in live mode." <<std::endl;
         return 0;
+    } else if(streaming){
+        double max = -2;
+        AudioFileReader<T> reader;
+        typename AudioFile<T>::AudioBuffer block;
+        reader.open (stream_filename);
+        // Run through audio file a block at a time
+        while (reader.read (block, stream_block_size) > 0){
+            for (int i = 0; i < block[0].size(); i++){
+                double sample = AudioSampleTraits<T>::toAmplitude(block[0][i]);
+                if (sample > max){
+                    max = sample;
+                }
+            }
+        }
+        return max;
     } else {
         double max = -2;
         // Run through audio file
-        for (int i = 0; i < audioFile.getNumSamplesPerChannel(); i++)
+        AudioChannelView<T> left = audioFile.samples[0];
+        for (int64_t i = 0; i < left.size(); i++)
         {
-            if (audioFile.samples[0][i]> max){
-                max = audioFile.samples[0][i];
+            double sample = AudioSampleTraits<T>::toAmplitude(left[i]);
+            if (sample > max){
+                max = sample;
             }
         }
         return max;
     }
 }
-double SampleSplitter::get_min(){
+template <class T>
+double BasicSampleSplitter<T>::get_min(){
     if(live){
         std::cout << "Can't find min in live mode." <<std::endl;
         return 0;
+    } else if(streaming){
+        double min = 2;
+        AudioFileReader<T> reader;
+        typename AudioFile<T>::AudioBuffer block;
+        reader.open (stream_filename);
+        // Run through audio file a block at a time
+        while (reader.read (block, stream_block_size) > 0){
+            for (int i = 0; i < block[0].size(); i++){
+                double sample = AudioSampleTraits<T>::toAmplitude(block[0][i]);
+                if (sample < min){
+                    min = sample;
+                }
+            }
+        }
+        return min;
     } else {
         double min = 2;
         // Run through audio file
-        for (int i = 0; i < audioFile.getNumSamplesPerChannel(); i++)
+        AudioChannelView<T> left = audioFile.samples[0];
+        for (int64_t i = 0; i < left.size(); i++)
         {
-            if (audioFile.samples[0][i]< min){
-                min = audioFile.samples[0][i];
+            double sample = AudioSampleTraits<T>::toAmplitude(left[i]);
+            if (sample < min){
+                min = sample;
             }
         }
         return min;
     }
 }
 
-void SampleSplitter::split_and_export_samples(double threshold, double grace_time, bool export_files){
+template <class T>
+void BasicSampleSplitter<T>::split_and_export_samples(double threshold, double grace_time, bool export_files){
     if(live){
         std::cout << "Can't manually split and export samples in live mode" << std::endl;
+    } else if(streaming){
+        // Only the sample being exported is ever read back into memory
+        split_samples_streaming(threshold, grace_time);
+        if(export_files){
+            export_all_samples();
+        }
     } else {
-        // Make buffer
-        AudioFile<double>::AudioBuffer buffer;
-        buffer.resize (2);
-        bool recording = false;     // Is the buffer recording?
+        SplitState state;
         int grace_sample_num = (int) (audioFile.getSampleRate()*grace_time);
-        int grace_period = 0; // grace samples to be counted down
-        int file_number = 1; 
+        T sample_threshold = AudioSampleTraits<T>::fromAmplitude(threshold);
         std::string file_name;
-        AudioFile<double> output_file;
-        output_file.setBitDepth (audioFile.getBitDepth());
-        output_file.setSampleRate (audioFile.getSampleRate());
+        // Samples are streamed straight from the audio file to disk
+        AudioFileWriter<T> writer;
         // Run through audio file
-        for (int i = 0; i < audioFile.getNumSamplesPerChannel(); i++)
-        {
-
-            if ((audioFile.samples[0][i]>threshold || audioFile.samples[1][i]>threshold)
-                && grace_period <= 0 && !recording){
-                recording = true;
-                grace_period = grace_sample_num;
-            } else if ((audioFile.samples[0][i]>threshold || audioFile.samples[1][i]>threshold)
-                && grace_period <= 0 && recording){
-                    if(export_files){
-                        file_name = "sample_" + std::to_string(file_number) + ".wav";
-                        output_file.setAudioBuffer (buffer);
-                        output_file.save (file_name);
-                        buffer.clear();
-                        buffer.resize (2);
-                    }
-                file_number++;
-                grace_period = grace_sample_num;
-            } 
-
-            if(recording){
-
-            buffer[0].push_back(audioFile.samples[0][i]);
-            buffer[1].push_back(audioFile.samples[1][i]);
-
+        split_frames(audioFile.samples[0].data(), audioFile.samples[1].data(), 0, audioFile.getNumSamplesPerChannel(),
+                     sample_threshold, grace_sample_num, state, [&](int64_t start, int64_t num_frames){
+            if(export_files){
+                TraceSpan span("export_sample", "audio");
+                file_name = "sample_" + std::to_string(state.file_number) + ".wav";
+                writer.open (file_name, audioFile.getNumChannels(), audioFile.getSampleRate(), audioFile.getBitDepth());
+                writer.write (audioFile.samples.getFrames (start, num_frames));
+                writer.close();
             }
-            grace_period--;
-        }
+        });
 
         // Export last sample
         if(export_files){
-            file_name = "sample_" + std::to_string(file_number) + ".wav";
-            output_file.setAudioBuffer (buffer);
-            output_file.save (file_name);
-            buffer.clear();
-            buffer.resize (2);
+            TraceSpan span("export_sample", "audio");
+            file_name = "sample_" + std::to_string(state.file_number) + ".wav";
+            writer.open (file_name, audioFile.getNumChannels(), audioFile.getSampleRate(), audioFile.getBitDepth());
+            if(state.recording){
+                writer.write (audioFile.samples.getFrames (state.sample_start, audioFile.getNumSamplesPerChannel() - state.sample_start));
+            }
+            writer.close();
         }
 
         if (export_files){
-            std::cout << "Exported " << (file_number) << " sample files." << std::endl;
+            std::cout << "Exported " << (state.file_number) << " sample files." << std::endl;
         } else {
-            std::cout << "Would have exported " << (file_number) << " sample files." << std::endl;
+            std::cout << "Would have exported " << (state.file_number) << " sample files." << std::endl;
         }
     }
 }
 
-void SampleSplitter::split_samples(double threshold, double grace_time){
+template <class T>
+void BasicSampleSplitter<T>::split_samples(double threshold, double grace_time){
     if(live){
         std::cout << "Can't manually split samples in live mode" << std::endl;
+    } else if(streaming){
+        split_samples_streaming(threshold, grace_time);
     } else {
-        // Make buffer
-        AudioFile<double>::AudioBuffer buffer;
-        buffer.resize (2);
-        bool recording = false;     // Is the buffer recording?
+        // Only where each sample starts and how long it is are recorded, so no audio is copied
+        sample_ranges.clear();
+        SplitState state;
         int grace_sample_num = (int) (audioFile.getSampleRate()*grace_time);
-        int grace_period = 0; // grace samples to be counted down
-        int file_number = 1; 
-        std::string file_name;
+        T sample_threshold = AudioSampleTraits<T>::fromAmplitude(threshold);
         // Run through audio file
-        for (int i = 0; i < audioFile.getNumSamplesPerChannel(); i++)
-        {
-
-            if ((audioFile.samples[0][i]>threshold || audioFile.samples[1][i]>threshold)
-                && grace_period <= 0 && !recording){
-                recording = true;
-                grace_period = grace_sample_num;
-            } else if ((audioFile.samples[0][i]>threshold || audioFile.samples[1][i]>threshold)
-                && grace_period <= 0 && recording){
-
-                file_name = "sample_" + std::to_string(file_number) + ".wav";
-                sample_list.push_back(buffer);
-                buffer.clear();
-                buffer.resize (2);
-
-                file_number++;
-                grace_period = grace_sample_num;
-            } 
-
-            if(recording){
-
-            buffer[0].push_back(audioFile.samples[0][i]);
-            buffer[1].push_back(audioFile.samples[1][i]);
-
-            }
-            grace_period--;
+        split_frames(audioFile.samples[0].data(), audioFile.samples[1].data(), 0, audioFile.getNumSamplesPerChannel(),
+                     sample_threshold, grace_sample_num, state, [this](int64_t start, int64_t num_frames){
+            sample_ranges.push_back(std::make_pair(start, num_frames));
+        });
+        // The last sample runs to the end of the file
+        if(state.recording){
+            sample_ranges.push_back(std::make_pair(state.sample_start, audioFile.getNumSamplesPerChannel() - state.sample_start));
+        } else {
+            sample_ranges.push_back(std::make_pair((int64_t) 0, (int64_t) 0));
         }
-        // Export last sample
-
-        file_name = "sample_" + std::to_string(file_number) + ".wav";
-        sample_list.push_back(buffer);
-        buffer.clear();
-        buffer.resize (2);
 
-        std::cout << "Split " << (file_number) << " sample files." << std::endl;
+        std::cout << "Split " << (state.file_number) << " sample files." << std::endl;
     }
 
 
 }
 
-void SampleSplitter::export_sample(double sample_number, std::string file_name){
+template <class T>
+void BasicSampleSplitter<T>::export_sample(double sample_number, std::string file_name){
     if (live){
         std::cout << "Can't export a specific samples in live mode" << std::endl;
         std::cout << "No samples were exported" << std::endl;
     } else {
-        if (sample_list.size() == 0){
+        if (num_split_samples() == 0){
             std::cout << "No samples to export" << std::endl;
             std::cout << "Did you split the original file into samples first?" << std::endl;
 
-        } else if(sample_number > 0 && sample_number <= sample_list.size()){
-            AudioFile<double> output_file;
-            output_file.setBitDepth (audioFile.getBitDepth());
-            output_file.setSampleRate (audioFile.getSampleRate());
-            output_file.setAudioBuffer (sample_list.at(sample_number-1));
-            output_file.save (file_name);
+        } else if(sample_number > 0 && sample_number <= num_split_samples()){
+            TraceSpan span("export_sample", "audio");
+            AudioFileWriter<T> writer;
+            std::pair<int64_t,int64_t> range = sample_ranges.at(sample_number-1);
+            if(streaming){
+                // Copy this sample from the .wav file to disk a block at a time, reading only its frames
+                PlanarAudioBuffer<T> block (audioFile.getNumChannels(), stream_block_size);
+                writer.open (file_name, audioFile.getNumChannels(), audioFile.getSampleRate(), audioFile.getBitDepth());
+                int64_t frame = range.first, frames_left = range.second, frames_read;
+                while (frames_left > 0
+                       && (frames_read = audioFile.readFrames (frame, std::min (frames_left, (int64_t) stream_block_size), block.getView())) > 0){
+                    writer.write (block.getFrames (0, frames_read));
+                    frame += frames_read;
+                    frames_left -= frames_read;
+                }
+            } else {
+                // Encode this sample straight from the audio file
+                writer.open (file_name, audioFile.getNumChannels(), audioFile.getSampleRate(), audioFile.getBitDepth());
+                writer.write (audioFile.samples.getFrames (range.first, range.second));
+            }
+            writer.close();
             std::cout << file_name << " was exported." << std::endl;
         } else{
-            std::cout << "There are " << sample_list.size() << " samples." << std::endl;
+            std::cout << "There are " << num_split_samples() << " samples." << std::endl;
             std::cout << "You asked for sample number " << sample_number << std::endl;
             std::cout << "No sample was exported" << std::endl;
         }
     }
 }
 
-void SampleSplitter::export_all_samples(){
+template <class T>
+void BasicSampleSplitter<T>::preview_sample(double sample_number, double seconds, PlanarAudioBuffer<T>& frames){
+    if (live){
+        std::cout << "Can't preview a sample in live mode" << std::endl;
+        frames.setSize(frames.getNumChannels(), 0);
+    } else if(sample_number > 0 && sample_number <= num_split_samples()){
+        std::pair<int64_t,int64_t> range = sample_ranges.at(sample_number-1);
+        int64_t num_frames = std::min(range.second, (int64_t) (audioFile.getSampleRate()*seconds));
+        // Works the same whether the file is loaded or streamed, as readFrames seeks to the sample in streaming mode
+        frames.setSize(audioFile.getNumChannels(), num_frames);
+        frames.setSize(audioFile.getNumChannels(), audioFile.readFrames(range.first, num_frames, frames.getView()));
+    } else {
+        std::cout << "There are " << num_split_samples() << " samples." << std::endl;
+        std::cout << "You asked to preview sample number " << sample_number << std::endl;
+        frames.setSize(frames.getNumChannels(), 0);
+    }
+}
+
+template <class T>
+void BasicSampleSplitter<T>::export_all_samples(){
     if(live){
         std::cout << "Can't export all samples in live mode" << std::endl;
         std::cout << "No samples were exported" << std::endl;
     } else {
-        if (sample_list.size() == 0){
+        if (num_split_samples() == 0){
             std::cout << "No samples to export" << std::endl;
             std::cout << "Did you split the original file into samples first?" << std::endl;
             std::cout << "No samples were exported" << std::endl;
         } else{
             std::string file_name;
-            for (int i = 1; i <= sample_list.size(); i++){
+            for (int i = 1; i <= num_split_samples(); i++){
                 file_name = "sample_" + std::to_string(i) + ".wav";
                 export_sample(i,file_name);
             }
@@ -388,94 +634,300 @@ void SampleSplitter::export_all_samples(){
     }
 }
 
-void SampleSplitter::export_all_samples(vector<std::string> file_names){
+template <class T>
+void BasicSampleSplitter<T>::export_all_samples(vector<std::string> file_names){
     if(live){
         std::cout << "Can't manually export all samples in live mode" << std::endl;
         std::cout << "No samples were exported" << std::endl;
     } else{
-        if (sample_list.size() == 0){
+        if (num_split_samples() == 0){
             std::cout << "No samples to export" << std::endl;
             std::cout << "Did you split the original file into samples first?" << std::endl;
             std::cout << "No samples were exported" << std::endl;
-        } else if(sample_list.size() != file_names.size()){
+        } else if(num_split_samples() != file_names.size()){
             std::cout << "The number of file names does not match the number of samples." << std::endl;
             std::cout << "No samples were exported" << std::endl;
         } else {
-            for (int i = 1; i <= sample_list.size(); i++){
+            for (int i = 1; i <= num_split_samples(); i++){
                 export_sample(i,file_names.at(i-1));
             }
         }
     }
 }
 
-// --------- live mode functions ------------------------------------------------------------------------
-
-void SampleSplitter::attempt_live_export(double threshold, double grace_time){
-    if(live){
-        // Make buffer
-        AudioFile<double>::AudioBuffer buffer;
-        buffer.resize (2);
-        bool recording = false;     // Is the buffer recording?
-        int grace_sample_num = (int) (sample_rate*grace_time);
-        int grace_period = 0; // grace samples to be counted down
-        int file_number = 1; 
-        std::string file_name;
-        AudioFile<double> output_file;
-        output_file.setBitDepth (bit_depth);
-        output_file.setSampleRate (sample_rate);
-        // Run through backlog 
-        for (int i = 0; i < backlog[0].size(); i++)
-        {
-
-            if ((backlog[0][i]>threshold || backlog[1][i]>threshold)
-                && grace_period <= 0 && !recording){
-                recording = true;
-                grace_period = grace_sample_num;
-            } else if ((backlog[0][i]>threshold || backlog[1][i]>threshold)
-                && grace_period <= 0 && recording){
+template <class T>
+const vector<std::pair<int64_t,int64_t>>& BasicSampleSplitter<T>::get_sample_ranges(){
+    return sample_ranges;
+}
 
-                file_name = "sample_" + std::to_string(export_number) + ".wav";
-                output_file.setAudioBuffer (buffer);
-                output_file.save (file_name);
-                std::cout << "Exported " << file_name << std::endl;
-                buffer.clear();
-                buffer.resize (2);
+template <class T>
+int BasicSampleSplitter<T>::num_split_samples(){
+    return sample_ranges.size();
+}
 
-                export_number++;
-                grace_period = grace_sample_num;
-            } 
+template <class T>
+void BasicSampleSplitter<T>::split_samples_streaming(double threshold, double grace_time){
+    AudioFileReader<T> reader;
+    if (!reader.open (stream_filename)){
+        std::cout << "Can't split " << stream_filename << std::endl;
+        return;
+    }
+    // Only one block of the file is held at a time
+    sample_ranges.clear();
+    typename AudioFile<T>::AudioBuffer block;
+    SplitState state;
+    int grace_sample_num = (int) (reader.getSampleRate()*grace_time);
+    T sample_threshold = AudioSampleTraits<T>::fromAmplitude(threshold);
+    int64_t frame = 0; // frame index in the whole file
+    int block_frames;
+    // Run through audio file a block at a time, with the same trigger logic as split_samples
+    while ((block_frames = reader.read (block, stream_block_size)) > 0){
+        split_frames(block[0].data(), block[1].data(), frame, block_frames,
+                     sample_threshold, grace_sample_num, state, [this](int64_t start, int64_t num_frames){
+            sample_ranges.push_back(std::make_pair(start, num_frames));
+        });
+        frame += block_frames;
+    }
+    // The last sample runs to the end of the file
+    if(state.recording){
+        sample_ranges.push_back(std::make_pair(state.sample_start, frame - state.sample_start));
+    } else {
+        sample_ranges.push_back(std::make_pair((int64_t) 0, (int64_t) 0));
+    }
 
-            if(recording){
+    std::cout << "Split " << (state.file_number) << " sample files." << std::endl;
+}
 
-            buffer[0].push_back(backlog[0][i]);
-            buffer[1].push_back(backlog[1][i]);
+template <class T>
+template <class F>
+void BasicSampleSplitter<T>::split_frames(const T* left, const T* right, int64_t first_frame, int64_t num_frames,
+                                          T threshold, int64_t grace_sample_num, SplitState& state, F on_sample){
+    int64_t i = 0;
+    while (i < num_frames){
+        if (state.grace_period > 0){
+            // Nothing can happen until the grace period is over
+            int64_t skipped = std::min(state.grace_period, num_frames - i);
+            state.grace_period -= skipped;
+            i += skipped;
+            continue;
+        }
+        int64_t trigger = find_frame_over(left, right, i, num_frames, threshold);
+        state.grace_period -= trigger - i;
+        i = trigger;
+        if (i == num_frames){
+            break;
+        }
+        if (state.recording){
+            on_sample(state.sample_start, first_frame + i - state.sample_start);
+            state.file_number++;
+        }
+        state.recording = true;
+        state.sample_start = first_frame + i;
+        // The grace period counts down from the frame that started the sample
+        state.grace_period = grace_sample_num - 1;
+        i++;
+    }
+}
 
-            }
-            grace_period--;
+template <class T>
+int64_t BasicSampleSplitter<T>::find_frame_over(const T* left, const T* right, int64_t begin, int64_t end, T threshold){
+    const int64_t block_size = 64;
+    int64_t i = begin;
+    for (; i + block_size <= end; i += block_size){
+        int over = 0;
+        for (int64_t k = i; k < i + block_size; k++){
+            over |= (left[k] > threshold) | (right[k] > threshold);
         }
+        if (over){
+            break;
+        }
+    }
+    for (; i < end; i++){
+        if (left[i] > threshold || right[i] > threshold){
+            return i;
+        }
+    }
+    return end;
+}
+
+// --------- live mode functions ------------------------------------------------------------------------
 
-        // The last "sample" becomes the new backlog
+template <class T>
+void BasicSampleSplitter<T>::attempt_live_export(double threshold, double grace_time){
+    if(live){
+        TraceSpan span("attempt_live_export", "splitter");
+        int grace_sample_num = (int) (sample_rate*grace_time);
+        T sample_threshold = AudioSampleTraits<T>::fromAmplitude(threshold);
+        int num_ready = backlog.getNumReady();
+
+        // The part of the backlog that hasn't been scanned yet is run through the same detector as non-live mode,
+        // so the frames in each grace period are skipped and the rest are compared a block at a time
+        SplitState state;
+        state.recording = live_recording;
+        state.grace_period = live_grace_period;
+        state.sample_start = live_sample_start;
+        // The rest of each sample is copied out of the backlog and written to disk in the background
+        auto on_sample = [this](int64_t start, int64_t num_frames) {
+            write_backlog_frames((int) start, (int) num_frames, true);
+            export_number++;
+        };
+        AudioBufferView<const T> first, second;
+        backlog.getFrames(scan_cursor, num_ready - scan_cursor, first, second);
+        split_frames(first[0].data(), first[1].data(), scan_cursor, first.getNumFrames(),
+                     sample_threshold, grace_sample_num, state, on_sample);
+        split_frames(second[0].data(), second[1].data(), scan_cursor + first.getNumFrames(), second.getNumFrames(),
+                     sample_threshold, grace_sample_num, state, on_sample);
+        scan_cursor = num_ready;
+        live_recording = state.recording;
+        live_grace_period = (int) state.grace_period;
+        live_sample_start = (int) state.sample_start;
+
+        // The last "sample" stays in the backlog
         // I do this so that I don't export incomplete samples
         // The result is that the last sample won't export until another sample recording has been triggered
         // Thus to make sure your last sample exports make a loud noise to trigger the end of that sample.
-        backlog.clear();
-        backlog.resize (2);
-        for(int i = 0; i < buffer[0].size(); i++){
-            backlog[0].push_back(buffer[0][i]);
-            backlog[1].push_back(buffer[1][i]);
+        discard_backlog(live_recording ? live_sample_start : scan_cursor);
+
+        // The scanned part of the sample being recorded won't change, so whole blocks of it are sent to be
+        // written now, rather than all of it being copied when the sample ends
+        int num_block_frames = live_recording ? scan_cursor - scan_cursor % export_block_frames : 0;
+        if (num_block_frames > 0){
+            write_backlog_frames(0, num_block_frames, false);
+            discard_backlog(num_block_frames);
         }
     } else {
         std::cout << "attempt_live_export is a live mode exclusive function" << std::endl;        
     }
 }
 
-void SampleSplitter::read_data_packet(json left_data, json right_data){
+template <class T>
+void BasicSampleSplitter<T>::read_data_packet(const json& left_data, const json& right_data){
     if(live){
-        for (int i = 0; i < left_data.size(); i++){
-            backlog[0].push_back(left_data[i]);
-            backlog[1].push_back(right_data[i]);
+        TraceSpan span("read_data_packet", "splitter");
+        int num_frames = left_data.size();
+        // The scratch space only grows, so steady packet sizes don't allocate
+        packet_left.resize(num_frames);
+        packet_right.resize(num_frames);
+        for (int i = 0; i < num_frames; i++){
+            packet_left[i] = AudioSampleTraits<T>::fromAmplitude(left_data[i].get<double>());
+            packet_right[i] = AudioSampleTraits<T>::fromAmplitude(right_data[i].get<double>());
         }
+        append_packet_to_backlog(num_frames);
     } else {
         std::cout << "read_data_packet is a live mode exclusive function" << std::endl;    
     }
-}
\ No newline at end of file
+}
+
+template <class T>
+void BasicSampleSplitter<T>::read_audio_packet(const AudioPacket& packet){
+    if(live){
+        TraceSpan span("read_audio_packet", "splitter");
+        int num_frames = packet.num_frames;
+        int right_channel = packet.num_channels > 1 ? 1 : 0;
+        // The scratch space only grows, so steady packet sizes don't allocate
+        packet_left.resize(num_frames);
+        packet_right.resize(num_frames);
+        for (int i = 0; i < num_frames; i++){
+            packet_left[i] = AudioSampleTraits<T>::fromAmplitude(packet.sample(i, 0));
+            packet_right[i] = AudioSampleTraits<T>::fromAmplitude(packet.sample(i, right_channel));
+        }
+        append_packet_to_backlog(num_frames);
+    } else {
+        std::cout << "read_audio_packet is a live mode exclusive function" << std::endl;    
+    }
+}
+
+template <class T>
+void BasicSampleSplitter<T>::append_packet_to_backlog(int num_frames){
+    if (backlog.getCapacity() == 0){
+        allocate_backlog();
+    }
+    if (backlog.getFreeSpace() < num_frames){
+        make_backlog_room(num_frames);
+    }
+    const T* channels[2] = {packet_left.data(), packet_right.data()};
+    dropped_frames += num_frames - backlog.write(channels, num_frames);
+}
+
+template <class T>
+int BasicSampleSplitter<T>::get_dropped_frames(){
+    return dropped_frames;
+}
+
+template <class T>
+long BasicSampleSplitter<T>::get_missed_packets(){
+    return missed_packets;
+}
+
+template <class T>
+long BasicSampleSplitter<T>::get_duplicate_packets(){
+    return audio ? audio->duplicates() : 0;
+}
+
+template <class T>
+void BasicSampleSplitter<T>::read_unread_packets(AudioChannel& audio){
+    // The unread packets are taken in one step, since the recorder may be sending on another thread.
+    // The channel drops duplicates, so each one is newer than the last.
+    for (const AudioPacketPtr& packet : audio.newer_than(last_sequence_number)){
+        missed_packets += packet->sequence_number - last_sequence_number - 1;
+        last_sequence_number = packet->sequence_number;
+        read_audio_packet(*packet);
+    }
+}
+
+template <class T>
+void BasicSampleSplitter<T>::allocate_backlog(){
+    backlog.setSize(2, (int) (sample_rate*std::max(4*gt, 1.0)));
+    scan_cursor = 0;
+    live_recording = false;
+    live_grace_period = 0;
+    live_sample_start = 0;
+}
+
+template <class T>
+void BasicSampleSplitter<T>::make_backlog_room(int num_frames){
+    // Scanning first releases any silence and finished samples
+    attempt_live_export(th, gt);
+    int shortfall = std::min(num_frames - backlog.getFreeSpace(), backlog.getNumReady());
+    if (shortfall > 0){
+        // What's left is the start of the sample being recorded
+        if (overflow_policy == BacklogOverflow::Spill){
+            write_backlog_frames(live_sample_start, shortfall, false);
+        } else {
+            dropped_frames += shortfall;
+        }
+        discard_backlog(shortfall);
+    }
+}
+
+template <class T>
+void BasicSampleSplitter<T>::write_backlog_frames(int start, int num_frames, bool last){
+    ExportJob<T> job;
+    job.file_name = "sample_" + std::to_string(export_number) + ".wav";
+    job.num_channels = backlog.getNumChannels();
+    job.sample_rate = sample_rate;
+    job.bit_depth = bit_depth;
+    job.first = !live_export_started;
+    job.last = last;
+
+    // The backlog frames are reused once discarded, so the job gets its own copy
+    AudioBufferView<const T> first, second;
+    backlog.getFrames(start, num_frames, first, second);
+    job.frames.setSizeUninitialised(job.num_channels, num_frames);
+    for (int channel = 0; channel < job.num_channels; channel++){
+        T* destination = job.frames[channel].data();
+        destination = std::copy(first[channel].begin(), first[channel].end(), destination);
+        std::copy(second[channel].begin(), second[channel].end(), destination);
+    }
+
+    // Jobs for the same sample share a key, so they're written in order by the same thread
+    export_pool->submit(export_number, std::move(job));
+    live_export_started = !last;
+}
+
+template <class T>
+void BasicSampleSplitter<T>::discard_backlog(int num_frames){
+    backlog.discard(num_frames);
+    scan_cursor -= num_frames;
+    live_sample_start = std::max(live_sample_start - num_frames, 0);
+}
@@ -1,5 +1,8 @@
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <exception>
 #include "elma.h"
 
 namespace elma {
@@ -15,6 +18,7 @@ namespace elma {
         process._period = period;
         _processes.push_back(&process); 
         process._manager_ptr = this;            
+        sort_processes();
 
         return *this;
 
@@ -31,13 +35,42 @@ namespace elma {
     //! Retrieve a reference to an existing channel. Throws an error if no such channel exists.
     //! \return The channel requested.
     Channel& Manager::channel(string name) {
-        if ( _channels.find(name) != _channels.end() ) {
-          return *(_channels[name]);
+        auto it = _channels.find(name);
+        if ( it != _channels.end() ) {
+          return *(it->second);
         } else {
             throw Exception("Tried to access an unregistered or non-existant channel.");
         }
     }    
 
+    //! Add an audio channel to the manager
+    //! \param The audio channel to be added
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::add_channel(AudioChannel& channel) {
+        _audio_channels[channel.name()] = &channel;
+        return *this;
+    }
+
+    //! Retrieve a reference to an existing audio channel. Throws an error if no such channel exists.
+    //! \return The audio channel requested.
+    AudioChannel& Manager::audio_channel(string name) {
+        auto it = _audio_channels.find(name);
+        if ( it != _audio_channels.end() ) {
+          return *(it->second);
+        } else {
+            throw Exception("Tried to access an unregistered or non-existant audio channel.");
+        }
+    }
+
+    //! Add a typed channel, such as a TypedChannel or an SpscChannel, to the manager.
+    //! Typed channels have their own names, separate from json and audio channels.
+    //! \param The channel to be added
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::add_channel(ChannelBase& channel) {
+        _typed_channels[channel.name()] = &channel;
+        return *this;
+    }
+
     //! Watch for an event associated with the given name.
     //! For watching events, you would typically register event handlers in your process'
     //! init() method. For example,
@@ -49,10 +82,42 @@ namespace elma {
     //! \param event_name The name of the event
     //! \handler A function or lambda that takes an event and returns nothing.
     Manager& Manager::watch(std::string event_name, std::function<void(Event&)> handler) {
-        event_handlers[event_name].push_back(handler);
+        return watch(event_id(event_name), handler);
+    }
+
+    //! Watch for an event by its id. See event_id().
+    //! \param id The id of the event
+    //! \handler A function or lambda that takes an event and returns nothing.
+    Manager& Manager::watch(event_id_type id, std::function<void(Event&)> handler) {
+        std::lock_guard<std::mutex> lock(_event_mutex);
+        if ( id < 0 || id >= (event_id_type) _event_handlers.size() ) {
+            throw Exception("Tried to watch an event with an unknown id.");
+        }
+        _event_handlers[id].push_back(std::move(handler));
         return *this;
     }
 
+    //! Get the id of an event name, giving it one if it doesn't have one yet. Processes
+    //! that emit an event often should look its id up once, in init(), and then emit
+    //! it by id, which calls its handlers without looking up the name. For example,
+    //! @code
+    //!     void init() { velocity_id = event_id("velocity"); }
+    //!     void update() { emit(velocity_id, Event("velocity", 3.41)); }
+    //! @endcode
+    //! \param event_name The name of the event
+    //! \return The id of the event
+    Manager::event_id_type Manager::event_id(std::string event_name) {
+        std::lock_guard<std::mutex> lock(_event_mutex);
+        auto it = _event_ids.find(event_name);
+        if ( it != _event_ids.end() ) {
+            return it->second;
+        }
+        event_id_type id = _event_handlers.size();
+        _event_handlers.emplace_back();
+        _event_ids[event_name] = id;
+        return id;
+    }
+
     //! Emit an event associated with a name.
     //! Typically, a process would emit events in its update() method using something like
     //! the following code"
@@ -63,16 +128,46 @@ namespace elma {
     //! @code
     //!     emit(Event("velocity", 3.41));
     //! @endcode
+    //! Events can be watched and emitted from any thread. The handlers run on the thread that
+    //! emitted the event, one after another, and may watch or emit events themselves.
     //! \param event The Event to be emitted
     //! \return A reference to the manager for chaining.
     Manager& Manager::emit(const Event& event) {
+        event_id_type id = -1;
+        {
+            std::lock_guard<std::mutex> lock(_event_mutex);
+            auto it = _event_ids.find(event.name());
+            if ( it != _event_ids.end() ) {
+                id = it->second;
+            }
+        }
+        if ( id >= 0 ) {
+            emit(id, event);
+        }
+        return *this;
+    }
+
+    //! Emit an event by its id, without looking up its name. See event_id().
+    //! \param id The id of the event
+    //! \param event The Event to be emitted
+    //! \return A reference to the manager for chaining.
+    Manager& Manager::emit(event_id_type id, const Event& event) {
         Event e = event; // make a copy so we can change propagation
-        if ( event_handlers.find(event.name()) != event_handlers.end() ) {
-            for ( auto handler : event_handlers[event.name()] ) {
-                if ( e.propagate() ) {
-                  handler(e);
+        // Indexed, so handlers watched by a handler are called too. Each handler is found under the
+        // lock but called outside it, which is safe because a deque never moves its elements.
+        for ( size_t i = 0; e.propagate(); i++ ) {
+            const std::function<void(Event&)> * handler;
+            {
+                std::lock_guard<std::mutex> lock(_event_mutex);
+                if ( id < 0 || id >= (event_id_type) _event_handlers.size() ) {
+                    throw Exception("Tried to emit an event with an unknown id.");
                 }
+                if ( i >= _event_handlers[id].size() ) {
+                    break;
+                }
+                handler = &_event_handlers[id][i];
             }
+            (*handler)(e);
         }
         return *this;
     }
@@ -102,18 +197,66 @@ namespace elma {
     //! Stop all processes. Usually not called directly.
     //! \return A reference to the manager, for chaining
     Manager& Manager::stop() {
-        return all([](Process& p) { p._stop(); });
+        all([](Process& p) { p._stop(); });
+        if ( _print_stats ) {
+            print_stats(std::cout);
+        }
+        if ( !_trace_file.empty() ) {
+            Trace::disable();
+            if ( !Trace::write(_trace_file) ) {
+                std::cout << "Warning: Elma could not write the trace to " << _trace_file << std::endl;
+            }
+        }
+        return *this;
     }    
 
+    //! Getter
+    //! \return The timing statistics of each process, in the order they were scheduled.
+    //! They cover the updates since the processes were last started. See ProcessStats.
+    vector<ProcessStats> Manager::stats() {
+        vector<ProcessStats> result;
+        for(auto process_ptr : _processes) {
+            result.push_back(process_ptr->stats());
+        }
+        return result;
+    }
+
+    //! Print the timing statistics of each process. Call it after run(), since in
+    //! THREADED mode the statistics are updated on each process's own thread.
+    //! \param out The stream to print to
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::print_stats(std::ostream& out) {
+        for(auto process_ptr : _processes) {
+            process_ptr->stats().print(out);
+        }
+        return *this;
+    }
+
+    //! Trace the next run, and write the trace to a file when it stops. The trace shows
+    //! when each update and each process's update happened and how long they took,
+    //! along with anything else timed with a TraceSpan, on every thread. It is saved
+    //! as Chrome trace JSON, for chrome://tracing or https://ui.perfetto.dev. See Trace.
+    //! \param file_name The file to write, or an empty string to stop tracing
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_trace_file(string file_name) {
+        _trace_file = file_name;
+        return *this;
+    }
+
+    //! Choose whether stop() prints the timing statistics of each process, which
+    //! show how long updates take and how often they run late. See ProcessStats.
+    //! \param print Whether to print the statistics
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_print_stats(bool print) {
+        _print_stats = print;
+        return *this;
+    }
+
     //! Update all processes if enough time has passed. Usually not called directly.
     //! \return A reference to the manager, for chaining
     Manager& Manager::update() {
-        _client.process_responses();
-        return all([this](Process& p) {
-            if ( _elapsed > p.last_update() + p.period() ) {
-                p._update(_elapsed);
-            }
-        });
+        update_group(_update_order, _elapsed, true);
+        return *this;
     }
 
     //! Run the manager for the specified amount of time.
@@ -123,11 +266,48 @@ namespace elma {
 
         _start_time = high_resolution_clock::now();
         _elapsed = high_resolution_clock::duration::zero();
+        _halted = false;
+        if ( !_trace_file.empty() ) {
+            // Each run's trace file holds that run alone
+            Trace::clear();
+            Trace::enable();
+        }
         start();        
 
-        while ( _elapsed < runtime ) {
-            update();
-            _elapsed = high_resolution_clock::now() - _start_time;
+        if ( _execution_mode == SINGLE_THREADED || _clock_mode == SIMULATED ) {
+            run_group(_update_order, runtime, true);
+        } else {
+            vector<vector<Process *>> groups = process_groups();
+            if ( groups.empty() ) {
+                groups.push_back(vector<Process *>());
+            }
+            // The first group runs on this thread, so client responses are still handled here
+            vector<std::exception_ptr> errors(groups.size());
+            vector<std::thread> threads;
+            for ( int i = 1; i < groups.size(); i++ ) {
+                threads.push_back(std::thread([this, &groups, &errors, runtime, i]() {
+                    try {
+                        run_group(groups[i], runtime, false);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                        _halted = true;
+                    }
+                }));
+            }
+            try {
+                run_group(groups[0], runtime, true);
+            } catch (...) {
+                errors[0] = std::current_exception();
+                _halted = true;
+            }
+            for ( auto& thread : threads ) {
+                thread.join();
+            }
+            for ( auto& error : errors ) {
+                if ( error ) {
+                    std::rethrow_exception(error);
+                }
+            }
         }
 
         stop();
@@ -136,4 +316,198 @@ namespace elma {
 
     }
 
+    //! Choose how run() shares processes between threads. See execution_mode_type.
+    //! In THREADED mode, any channels shared by processes in different groups are
+    //! locked as they're used, and event handlers run on the thread of the process
+    //! that emitted the event. Client responses are handled on the thread that called run().
+    //! \param mode Either SINGLE_THREADED or THREADED
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_execution_mode(execution_mode_type mode) {
+        _execution_mode = mode;
+        return *this;
+    }
+
+    //! Choose where run() gets the time from. See clock_mode_type.
+    //! \param mode Either REAL_TIME or SIMULATED
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_clock_mode(clock_mode_type mode) {
+        _clock_mode = mode;
+        return *this;
+    }
+
+    //! Declare that one process consumes what another produces. The producer is always
+    //! updated before the consumer when both are due at once, and in THREADED mode the
+    //! two run on the same thread. Both processes must already be scheduled.
+    //! \param consumer The process that reads what the producer sends
+    //! \param producer The process that the consumer waits for
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::depends_on(Process& consumer, Process& producer) {
+        if ( consumer._manager_ptr != this || producer._manager_ptr != this ) {
+            throw Exception("Tried to declare a dependency between processes that aren't scheduled.");
+        }
+        _dependencies.push_back(std::make_pair(&consumer, &producer));
+        try {
+            sort_processes();
+        } catch (const Exception&) {
+            _dependencies.pop_back();
+            throw;
+        }
+        return *this;
+    }
+
+    //! Getter
+    //! \return The groups of processes that run on the same thread in THREADED mode,
+    //! each one in the order its processes are updated
+    vector<vector<Process *>> Manager::process_groups() {
+
+        // Label each process with the first process it's connected to
+        map<Process *, Process *> leader;
+        for(auto process_ptr : _processes) {
+            leader[process_ptr] = process_ptr;
+        }
+        auto find_leader = [&leader](Process * p) {
+            while ( leader[p] != p ) {
+                p = leader[p];
+            }
+            return p;
+        };
+        for(auto& dependency : _dependencies) {
+            Process * a = find_leader(dependency.first),
+                    * b = find_leader(dependency.second);
+            if ( a != b ) {
+                leader[std::max(a, b)] = std::min(a, b);
+            }
+        }
+
+        vector<vector<Process *>> groups;
+        map<Process *, int> group_index;
+        for(auto process_ptr : _update_order) {
+            Process * l = find_leader(process_ptr);
+            if ( group_index.find(l) == group_index.end() ) {
+                group_index[l] = groups.size();
+                groups.push_back(vector<Process *>());
+            }
+            groups[group_index[l]].push_back(process_ptr);
+        }
+        return groups;
+
+    }
+
+    // Work out the update order: the order the processes were scheduled in, except that
+    // every producer comes before its consumers. Throws an error if the dependencies form a cycle.
+    void Manager::sort_processes() {
+
+        vector<Process *> order;
+        vector<Process *> remaining = _processes;
+
+        while ( !remaining.empty() ) {
+            auto next = std::find_if(remaining.begin(), remaining.end(), [this, &remaining](Process * p) {
+                for(auto& dependency : _dependencies) {
+                    if ( dependency.first == p && 
+                         std::find(remaining.begin(), remaining.end(), dependency.second) != remaining.end() ) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+            if ( next == remaining.end() ) {
+                throw Exception("Process dependencies form a cycle.");
+            }
+            order.push_back(*next);
+            remaining.erase(next);
+        }
+
+        _update_order = order;
+
+    }
+
+    // Update and wait for a group of processes until the runtime is up. The thread
+    // that handles client responses also keeps _elapsed up to date.
+    void Manager::run_group(const vector<Process *>& group, 
+                            high_resolution_clock::duration runtime, 
+                            bool handle_responses) {
+
+        high_resolution_clock::duration elapsed = high_resolution_clock::duration::zero();
+
+        while ( elapsed < runtime && !_halted ) {
+            update_group(group, elapsed, handle_responses);
+            wait_for_next_update(group, runtime, elapsed);
+            if ( handle_responses ) {
+                _elapsed = elapsed;
+            }
+        }
+
+    }
+
+    // Update every process in the group that's due at the given elapsed time, in order,
+    // handling any client responses first if asked to.
+    void Manager::update_group(const vector<Process *>& group, 
+                               high_resolution_clock::duration elapsed, 
+                               bool handle_responses) {
+
+        TraceSpan span("Manager::update");
+        if ( handle_responses ) {
+            _client.process_responses();
+        }
+        for(auto process_ptr : group) {
+            if ( elapsed > process_ptr->last_update() + process_ptr->period() ) {
+                process_ptr->_update(elapsed);
+            }
+        }
+
+    }
+
+    //! Choose how run() waits between updates. See run_policy_type.
+    //! \param policy Either LOWEST_JITTER or LOWEST_CPU
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_run_policy(run_policy_type policy) {
+        _run_policy = policy;
+        return *this;
+    }
+
+    //! Choose how long before each update run() stops sleeping and starts spinning, in
+    //! LOWEST_JITTER mode. It should be a little longer than the operating system usually
+    //! oversleeps by.
+    //! \param margin The time to spin for
+    //! \return A reference to the manager, for chaining
+    Manager& Manager::set_spin_margin(high_resolution_clock::duration margin) {
+        if ( margin < high_resolution_clock::duration::zero() ) {
+            throw Exception("Spin margin must not be negative.");
+        }
+        _spin_margin = margin;
+        return *this;
+    }
+
+    // Sleep until the next process in the group is due to be updated, or the runtime is up,
+    // and set elapsed to the time of waking up. With a SIMULATED clock, skip to that time instead. A process is due once the elapsed time
+    // is strictly later than its last update plus its period.
+    void Manager::wait_for_next_update(const vector<Process *>& group, 
+                                       high_resolution_clock::duration runtime, 
+                                       high_resolution_clock::duration& elapsed) {
+
+        high_resolution_clock::duration deadline = runtime;
+        for(auto process_ptr : group) {
+            deadline = std::min(deadline, process_ptr->last_update() + process_ptr->period());
+        }
+
+        if ( _clock_mode == SIMULATED ) {
+            // Just after the deadline, which is the earliest time the next process is due
+            elapsed = std::max(elapsed, deadline + high_resolution_clock::duration(1));
+        } else if ( _run_policy == LOWEST_JITTER ) {
+            if ( deadline - _spin_margin > elapsed ) {
+                std::this_thread::sleep_until(_start_time + deadline - _spin_margin);
+            }
+            do {
+                elapsed = high_resolution_clock::now() - _start_time;
+            } while ( elapsed <= deadline );
+        } else {
+            elapsed = high_resolution_clock::now() - _start_time;
+            while ( elapsed <= deadline ) {
+                std::this_thread::sleep_until(_start_time + deadline + high_resolution_clock::duration(1));
+                elapsed = high_resolution_clock::now() - _start_time;
+            }
+        }
+
+    }
+
 }
\ No newline at end of file
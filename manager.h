@@ -3,8 +3,12 @@
 
 #include <vector>
 #include <map>
+#include <deque>
 #include <chrono>
 #include <functional>
+#include <atomic>
+#include <mutex>
+#include <iostream>
 
 #include "elma.h"
 
@@ -13,9 +17,12 @@ namespace elma {
     using std::string;
     using std::vector;
     using std::map;
+    using std::deque;
     using namespace std::chrono;
 
     class Channel;
+    class AudioChannel;
+    class ChannelBase;
     class Process;
 
     //! The Process Manager class. 
@@ -27,8 +34,35 @@ namespace elma {
 
         public: 
 
+        //! How run() waits between updates. Both sleep until shortly before the next process
+        //! is due, rather than spinning, so the manager doesn't hold a core while it waits.
+        //! LOWEST_JITTER spins for the last spin_margin() of each wait, so updates happen as close
+        //! to on time as possible. LOWEST_CPU sleeps for the whole wait and accepts that the
+        //! operating system may wake it a little late.
+        typedef enum { LOWEST_JITTER, LOWEST_CPU } run_policy_type;
+
+        //! How run() shares processes between threads. SINGLE_THREADED updates every
+        //! process on the thread that called run(). THREADED splits the processes into
+        //! groups, where two processes are in the same group if one depends on the other
+        //! (see depends_on), and runs each group on its own thread, so a slow process only
+        //! holds up the processes it's connected to.
+        typedef enum { SINGLE_THREADED, THREADED } execution_mode_type;
+
+        //! Where run() gets the time from. REAL_TIME reads the system clock and waits for
+        //! each update to come due. SIMULATED doesn't wait: after each round of updates it
+        //! moves the elapsed time straight on to the next one due, so a run takes only as
+        //! long as its updates do. Processes are updated in the same order either way.
+        //! A SIMULATED run updates every process on the calling thread, whatever the
+        //! execution mode, since threads with their own virtual clocks would drift apart.
+        typedef enum { REAL_TIME, SIMULATED } clock_mode_type;
+
+        //! A handle for an event name, from event_id(). Watching and emitting by handle
+        //! skips looking the name up, so it's the way to emit events in update().
+        typedef int event_id_type;
+
         //! Default constructor
-        Manager() {}
+        Manager() : _run_policy(LOWEST_JITTER), _spin_margin(microseconds(100)), 
+                    _execution_mode(SINGLE_THREADED), _clock_mode(REAL_TIME), _print_stats(false), _halted(false) {}
         
         Manager& schedule(Process& process, high_resolution_clock::duration period);
         Manager& all(std::function<void(Process&)> f);
@@ -40,6 +74,41 @@ namespace elma {
 
         Manager& run(high_resolution_clock::duration);
 
+        Manager& set_run_policy(run_policy_type policy);
+        Manager& set_spin_margin(high_resolution_clock::duration margin);
+        Manager& set_execution_mode(execution_mode_type mode);
+        Manager& set_clock_mode(clock_mode_type mode);
+        Manager& set_print_stats(bool print);
+        Manager& set_trace_file(string file_name);
+        Manager& depends_on(Process& consumer, Process& producer);
+        vector<vector<Process *>> process_groups();
+        vector<ProcessStats> stats();
+        Manager& print_stats(std::ostream& out);
+
+        //! Getter
+        //! \return How run() waits between updates
+        inline run_policy_type run_policy() { return _run_policy; }
+
+        //! Getter
+        //! \return How long before each update run() stops sleeping and starts spinning, in LOWEST_JITTER mode
+        inline high_resolution_clock::duration spin_margin() { return _spin_margin; }
+
+        //! Getter
+        //! \return How run() shares processes between threads
+        inline execution_mode_type execution_mode() { return _execution_mode; }
+
+        //! Getter
+        //! \return Where run() gets the time from
+        inline clock_mode_type clock_mode() { return _clock_mode; }
+
+        //! Getter
+        //! \return Whether stop() prints the timing statistics of each process
+        inline bool prints_stats() { return _print_stats; }
+
+        //! Getter
+        //! \return The file the trace of each run is written to, or an empty string if runs aren't traced
+        inline string trace_file() { return _trace_file; }
+
         //! Getter
         //! \return The time the Manager was most recently started
         inline high_resolution_clock::time_point start_time() { return _start_time; }
@@ -51,22 +120,108 @@ namespace elma {
         // Channel Interface
         Manager& add_channel(Channel&);
         Channel& channel(string);
+        Manager& add_channel(AudioChannel&);
+        AudioChannel& audio_channel(string);
+        Manager& add_channel(ChannelBase&);
+        template <class T> TypedChannel<T>& typed_channel(string);
+        template <class T> SpscChannel<T>& spsc_channel(string);
 
         // Event Interface
+        event_id_type event_id(string event_name);
         Manager& watch(string event_name, std::function<void(Event&)> handler);
+        Manager& watch(event_id_type id, std::function<void(Event&)> handler);
         Manager& emit(const Event& event);
+        Manager& emit(event_id_type id, const Event& event);
         Client& client() { return _client; }
 
         private:
+        template <class C> C& find_typed_channel(string name);
+        void sort_processes();
+        void run_group(const vector<Process *>& group, high_resolution_clock::duration runtime, bool handle_responses);
+        void update_group(const vector<Process *>& group, high_resolution_clock::duration elapsed, bool handle_responses);
+        void wait_for_next_update(const vector<Process *>& group, 
+                                  high_resolution_clock::duration runtime, 
+                                  high_resolution_clock::duration& elapsed);
+
         vector<Process *> _processes;
+        vector<Process *> _update_order;                        // _processes, with producers before their consumers
+        vector<std::pair<Process *, Process *>> _dependencies;  // (consumer, producer) pairs
         map<string, Channel *> _channels;
-        map<string, vector<std::function<void(Event&)>>> event_handlers;
+        map<string, AudioChannel *> _audio_channels;
+        map<string, ChannelBase *> _typed_channels;
+        map<string, event_id_type> _event_ids;
+        deque<deque<std::function<void(Event&)>>> _event_handlers;  // by event id; deques stay put if a handler watches
+        std::mutex _event_mutex;                                // guards _event_ids and _event_handlers
         high_resolution_clock::time_point _start_time;
         high_resolution_clock::duration _elapsed;
         Client _client;
+        run_policy_type _run_policy;
+        high_resolution_clock::duration _spin_margin;
+        execution_mode_type _execution_mode;
+        clock_mode_type _clock_mode;
+        bool _print_stats;
+        string _trace_file;
+        std::atomic<bool> _halted;                              // set when a process throws, to stop the other threads
 
     };
 
+    //! Retrieve a reference to an existing typed channel. Throws an error if no such channel
+    //! exists, or if it carries a different type of value.
+    //! \return The channel requested.
+    template <class T>
+    TypedChannel<T>& Manager::typed_channel(string name) {
+        return find_typed_channel<TypedChannel<T>>(name);
+    }
+
+    //! Retrieve a reference to an existing lock-free channel. Throws an error if no such channel
+    //! exists, or if it carries a different type of value.
+    //! \return The channel requested.
+    template <class T>
+    SpscChannel<T>& Manager::spsc_channel(string name) {
+        return find_typed_channel<SpscChannel<T>>(name);
+    }
+
+    template <class C>
+    C& Manager::find_typed_channel(string name) {
+        auto it = _typed_channels.find(name);
+        if ( it == _typed_channels.end() ) {
+            throw Exception("Tried to access an unregistered or non-existant channel.");
+        }
+        C * channel = dynamic_cast<C *>(it->second);
+        if ( channel == NULL ) {
+            throw Exception("Tried to access channel " + name + " as the wrong type of channel.");
+        }
+        return *channel;
+    }
+
+    // Process's typed channel accessors need the Manager to be defined, so they're here
+
+    //! Access a typed channel with the given name
+    /*!
+      \param name The name of the channel
+      \return A reference to the channel
+    */
+    template <class T>
+    TypedChannel<T>& Process::typed_channel(string name) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access channels in a process before the process is scheduled.");
+        }
+        return _manager_ptr->typed_channel<T>(name);
+    }
+
+    //! Access a lock-free channel with the given name
+    /*!
+      \param name The name of the channel
+      \return A reference to the channel
+    */
+    template <class T>
+    SpscChannel<T>& Process::spsc_channel(string name) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access channels in a process before the process is scheduled.");
+        }
+        return _manager_ptr->spsc_channel<T>(name);
+    }
+
 }
 
 #endif
\ No newline at end of file
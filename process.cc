@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <algorithm>
 #include "elma.h"
 
 namespace elma {
@@ -16,6 +17,19 @@ namespace elma {
         }
     }
 
+    //! Access an audio channel with the given name
+    /*!
+      \param name The name of the audio channel
+      \return A reference to the audio channel
+    */
+    AudioChannel& Process::audio_channel(string name) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access channels in a process before the process is scheduled.");
+        } else {
+            return _manager_ptr->audio_channel(name);
+        }
+    }
+
     void Process::watch(string event_name, std::function<void(Event&)> handler) {
         if ( _manager_ptr == NULL ) {
             throw Exception("Cannot access events in a process before the process is scheduled.");
@@ -32,6 +46,35 @@ namespace elma {
         }
     }
 
+    //! Get the id of an event name, for watching or emitting it without looking up the name
+    /*!
+      \param event_name The name of the event
+      \return The id of the event
+    */
+    int Process::event_id(string event_name) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access events in a process before the process is scheduled.");
+        } else {
+            return _manager_ptr->event_id(event_name);
+        }
+    }
+
+    void Process::watch(int id, std::function<void(Event&)> handler) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access events in a process before the process is scheduled.");
+        } else {        
+            _manager_ptr->watch(id, handler);
+        }
+    }
+
+    void Process::emit(int id, const Event& event) {
+        if ( _manager_ptr == NULL ) {
+            throw Exception("Cannot access events in a process before the process is scheduled.");
+        } else {        
+            _manager_ptr->emit(id, event);
+        }
+    }
+
     void Process::http_get(std::string url, std::function<void(json&)> handler) {
         _manager_ptr->client().get(url,handler);
     }
@@ -67,14 +110,20 @@ namespace elma {
         _start_time = high_resolution_clock::now();
         _last_update = elapsed;
         _num_updates = 0;
+        _stats.reset(_period);
         start();
     }
 
     // Manager interface for the _update method. Do not call directly. 
     void Process::_update(high_resolution_clock::duration elapsed) {
+        high_resolution_clock::duration lateness = std::max(elapsed - (_last_update + _period), 
+                                                            high_resolution_clock::duration::zero());
         _previous_update = _last_update;
         _last_update = elapsed;
+        high_resolution_clock::time_point update_start = high_resolution_clock::now();
+        TraceSpan span(_name.c_str(), "process");
         update();
+        _stats.record(lateness, high_resolution_clock::now() - update_start);
         _num_updates++;
     }
 
@@ -11,6 +11,9 @@ namespace elma {
 
     class Manager;
     class Channel;
+    class AudioChannel;
+    template <class T> class TypedChannel;
+    template <class T> class SpscChannel;
 
     using std::string;
     using namespace std::chrono;
@@ -32,13 +35,13 @@ namespace elma {
         typedef enum { UNINITIALIZED, STOPPED, RUNNING } status_type;
 
         //! Default constructor. Names process "no name"
-        Process() : _name("unnamed process"), _status(UNINITIALIZED), _manager_ptr(NULL) {}
+        Process() : _name("unnamed process"), _status(UNINITIALIZED), _manager_ptr(NULL), _stats(_name) {}
 
         //! Constructor that takes a name for the process
         /*!
           \param name The name of the process
         */
-        Process(std::string name) : _name(name), _status(UNINITIALIZED), _manager_ptr(NULL) {}
+        Process(std::string name) : _name(name), _status(UNINITIALIZED), _manager_ptr(NULL), _stats(name) {}
         virtual ~Process() = default;
 
         // Interface for derived classes
@@ -97,13 +100,23 @@ namespace elma {
         //! time the Manager called the update() method.        
         inline high_resolution_clock::duration previous_update() { return _previous_update; }
 
+        //! Getter
+        //! \return How long the updates since the process was last started took, and how late they were
+        inline const ProcessStats& stats() { return _stats; }
+
         // documentation for these methods is in process.cc
         Channel& channel(string name);
+        AudioChannel& audio_channel(string name);
+        template <class T> TypedChannel<T>& typed_channel(string name);
+        template <class T> SpscChannel<T>& spsc_channel(string name);
         double milli_time();
         double delta();
 
+        int event_id(string event_name);
         void watch(string event_name, std::function<void(Event&)> handler);
+        void watch(int id, std::function<void(Event&)> handler);
         void emit(const Event& event);
+        void emit(int id, const Event& event);
 
         void http_get(std::string url, std::function<void(json&)> handler);
 
@@ -124,6 +137,7 @@ namespace elma {
         time_point<high_resolution_clock> _start_time;    // time of most recent start
         int _num_updates;                                 // number of times update() has been called
         Manager * _manager_ptr;                           // a pointer to the manager        
+        ProcessStats _stats;                              // timing of the updates since the last start
 
     };
 
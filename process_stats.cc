@@ -0,0 +1,83 @@
+#include <algorithm>
+#include "elma.h"
+
+namespace elma {
+
+    //! Clear the statistics. Called by the Process when it is started.
+    //! \param period The period of the process, for counting overruns
+    void ProcessStats::reset(high_resolution_clock::duration period) {
+        _period = period;
+        _min_duration = high_resolution_clock::duration::max();
+        _max_duration = high_resolution_clock::duration::zero();
+        _total_duration = high_resolution_clock::duration::zero();
+        _max_lateness = high_resolution_clock::duration::zero();
+        _total_lateness = high_resolution_clock::duration::zero();
+        _num_updates = 0;
+        _overruns = 0;
+        _missed_deadlines = 0;
+        _histogram.assign(NUM_BUCKETS, 0);
+    }
+
+    //! Record an update. Called by the Process after each update.
+    //! \param lateness How long after the process was due the update started
+    //! \param duration How long the update took
+    void ProcessStats::record(high_resolution_clock::duration lateness, high_resolution_clock::duration duration) {
+
+        _num_updates++;
+        _min_duration = std::min(_min_duration, duration);
+        _max_duration = std::max(_max_duration, duration);
+        _total_duration += duration;
+        _max_lateness = std::max(_max_lateness, lateness);
+        _total_lateness += lateness;
+
+        if ( duration > _period ) {
+            _overruns++;
+        }
+        if ( lateness >= _period ) {
+            _missed_deadlines++;
+        }
+
+        int bucket = 0;
+        while ( bucket < NUM_BUCKETS - 1 && duration >= bucket_limit(bucket) ) {
+            bucket++;
+        }
+        _histogram[bucket]++;
+
+    }
+
+    //! The upper limit of a bucket in the histogram of update times. The limits
+    //! double from one microsecond, so the buckets cover a few hundred nanoseconds
+    //! to several seconds.
+    //! \param bucket The index of the bucket
+    //! \return The shortest update too long for the bucket
+    high_resolution_clock::duration ProcessStats::bucket_limit(int bucket) {
+        return microseconds(1L << bucket);
+    }
+
+    //! Print a summary of the statistics, and the histogram of update times
+    //! \param out The stream to print to
+    void ProcessStats::print(std::ostream& out) const {
+
+        auto us = [](high_resolution_clock::duration d) { return duration_cast<microseconds>(d).count(); };
+
+        out << _name << ": " << _num_updates << " updates every " << us(_period) << " us" << std::endl;
+        if ( _num_updates == 0 ) {
+            return;
+        }
+        out << "  update time (us): min " << us(_min_duration)
+            << ", mean " << us(mean_duration())
+            << ", max " << us(_max_duration)
+            << ", overruns " << _overruns << std::endl;
+        out << "  lateness (us): mean " << us(mean_lateness())
+            << ", max " << us(_max_lateness)
+            << ", missed deadlines " << _missed_deadlines << std::endl;
+        for ( int i = 0; i < NUM_BUCKETS; i++ ) {
+            if ( _histogram[i] > 0 ) {
+                out << "  " << (i < NUM_BUCKETS - 1 ? "< " : ">= ")
+                    << us(bucket_limit(i < NUM_BUCKETS - 1 ? i : i - 1)) << " us: " << _histogram[i] << std::endl;
+            }
+        }
+
+    }
+
+}
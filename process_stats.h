@@ -0,0 +1,119 @@
+#ifndef PROCESS_STATS_H
+#define PROCESS_STATS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+namespace elma {
+
+    using std::string;
+    using std::vector;
+    using namespace std::chrono;
+
+    //! Timing statistics for a Process, collected by the Manager as it runs.
+
+    //! Each update records how long the process's update() method took, and how late
+    //! the update started, measured from when the process was due (its previous update
+    //! plus its period). An update that takes longer than the period is an overrun. An
+    //! update that starts a whole period or more late is a missed deadline, since the
+    //! process should have been updated again by then. Update times are also counted
+    //! in a histogram, so the typical and worst cases can be told apart.
+    //! The statistics are reset every time the process is started.
+    //! @code
+    //!     m.run(26_s);
+    //!     for ( auto& stats : m.stats() ) {
+    //!         std::cout << stats.name() << " overran " << stats.overruns() << " times\n";
+    //!     }
+    //! @endcode
+    class ProcessStats {
+
+        public:
+
+        //! The number of buckets in the histogram of update times
+        static const int NUM_BUCKETS = 24;
+
+        //! Constructor
+        //! \param name The name of the process
+        ProcessStats(string name) : _name(name) { reset(high_resolution_clock::duration::zero()); }
+
+        void reset(high_resolution_clock::duration period);
+        void record(high_resolution_clock::duration lateness, high_resolution_clock::duration duration);
+        void print(std::ostream& out) const;
+
+        static high_resolution_clock::duration bucket_limit(int bucket);
+
+        //! Getter
+        //! \return The name of the process
+        inline string name() const { return _name; }
+
+        //! Getter
+        //! \return The period of the process when it was last started
+        inline high_resolution_clock::duration period() const { return _period; }
+
+        //! Getter
+        //! \return The number of updates recorded
+        inline long num_updates() const { return _num_updates; }
+
+        //! Getter
+        //! \return The shortest update
+        inline high_resolution_clock::duration min_duration() const { return _min_duration; }
+
+        //! Getter
+        //! \return The longest update
+        inline high_resolution_clock::duration max_duration() const { return _max_duration; }
+
+        //! Getter
+        //! \return The time spent in all of the updates
+        inline high_resolution_clock::duration total_duration() const { return _total_duration; }
+
+        //! Getter
+        //! \return The average update, or zero if there have been none
+        inline high_resolution_clock::duration mean_duration() const {
+            return _num_updates > 0 ? _total_duration / _num_updates : high_resolution_clock::duration::zero();
+        }
+
+        //! Getter
+        //! \return The latest any update started
+        inline high_resolution_clock::duration max_lateness() const { return _max_lateness; }
+
+        //! Getter
+        //! \return The average lateness of the updates, or zero if there have been none
+        inline high_resolution_clock::duration mean_lateness() const {
+            return _num_updates > 0 ? _total_lateness / _num_updates : high_resolution_clock::duration::zero();
+        }
+
+        //! Getter
+        //! \return The number of updates that took longer than the period
+        inline long overruns() const { return _overruns; }
+
+        //! Getter
+        //! \return The number of updates that started a period or more late
+        inline long missed_deadlines() const { return _missed_deadlines; }
+
+        //! Getter
+        //! \return The histogram of update times. Bucket i counts the updates shorter
+        //! than bucket_limit(i) but not shorter than bucket_limit(i-1). The last
+        //! bucket also counts anything longer.
+        inline const vector<long>& histogram() const { return _histogram; }
+
+        private:
+
+        string _name;
+        high_resolution_clock::duration _period,
+                                        _min_duration,
+                                        _max_duration,
+                                        _total_duration,
+                                        _max_lateness,
+                                        _total_lateness;
+        long _num_updates,
+             _overruns,
+             _missed_deadlines;
+        vector<long> _histogram;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Helpers shared by the test programs in this directory. Each program is
+// built from a single .cc file, so they're defined here rather than in a library.
+
+//! The number of checks that have failed so far
+static int failures = 0;
+
+//! Reports a failed check
+//! \param passed Whether the check passed
+//! \param what What was checked, printed if it failed
+inline void check(bool passed, std::string what){
+    if (!passed){
+        std::cout << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+//! Reports whether every check passed, for returning from main
+//! \param name What the program tests
+//! \return 0 if every check passed, and 1 otherwise
+inline int finish(std::string name){
+    if (failures == 0){
+        std::cout << "All " << name << " tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//! Appends a four character chunk id, or any other text, to the bytes of a handmade file
+inline void add_id(std::vector<uint8_t>& bytes, std::string id){
+    bytes.insert(bytes.end(), id.begin(), id.end());
+}
+
+#endif
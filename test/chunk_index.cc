@@ -0,0 +1,117 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "AudioChunkIndex.h"
+#include "check.h"
+
+// Checks that AudioChunkIndex walks handmade .wav and .aiff headers chunk by
+// chunk, from memory and from a stream
+
+void add_size(std::vector<uint8_t>& bytes, uint32_t size, bool big_endian){
+    for (int i = 0; i < 4; i++){
+        bytes.push_back((size >> (big_endian ? 24 - 8 * i : 8 * i)) & 0xFF);
+    }
+}
+
+// Adds a chunk whose payload is filled with the given text, repeated, plus a pad byte if its size is odd
+void add_chunk(std::vector<uint8_t>& bytes, std::string id, uint32_t size, std::string fill, bool big_endian = false){
+    add_id(bytes, id);
+    add_size(bytes, size, big_endian);
+    for (uint32_t i = 0; i < size + (size & 1); i++){
+        bytes.push_back(fill[i % fill.size()]);
+    }
+}
+
+// Whether a chunk was found where it should be
+bool found(const AudioChunkIndex& index, std::string id, uint64_t offset, uint64_t size){
+    const AudioChunk* chunk = index.find(id);
+    return chunk != nullptr && chunk->offset == offset && chunk->size == size;
+}
+
+// Builds the index from memory and from a stream, checking they agree
+bool build_both(AudioChunkIndex& index, const std::vector<uint8_t>& bytes){
+    std::istringstream stream(std::string(bytes.begin(), bytes.end()));
+    AudioChunkIndex from_stream;
+    bool stream_built = from_stream.build(stream);
+    bool built = index.build(bytes.data(), bytes.size());
+
+    bool same = built == stream_built && index.getChunks().size() == from_stream.getChunks().size();
+    for (size_t i = 0; same && i < index.getChunks().size(); i++){
+        same = index.getChunks()[i].id == from_stream.getChunks()[i].id
+            && index.getChunks()[i].offset == from_stream.getChunks()[i].offset
+            && index.getChunks()[i].size == from_stream.getChunks()[i].size;
+    }
+    check(same, "building from a stream finds the same chunks as from memory");
+    check(stream.good(), "the stream is left in a good state");
+    return built;
+}
+
+void test_wave(){
+
+    // A LIST chunk full of the text "data", with an odd size, before the real fmt and data chunks
+    std::vector<uint8_t> bytes;
+    add_id(bytes, "RIFF");
+    add_size(bytes, 0, false);
+    add_id(bytes, "WAVE");
+    add_chunk(bytes, "LIST", 13, "data");
+    add_chunk(bytes, "fmt ", 16, "\x01");
+    add_chunk(bytes, "data", 8, "\x7f");
+
+    AudioChunkIndex index;
+    check(build_both(index, bytes), "a RIFF file is indexed");
+    check(index.getContainer() == AudioChunkIndex::Container::Riff && index.getFormType() == "WAVE", "the RIFF header is read");
+    check(index.getChunks().size() == 3, "every chunk is found once");
+    check(found(index, "LIST", 20, 13), "the first chunk");
+    check(found(index, "fmt ", 42, 16), "a chunk after an odd sized one starts after its pad byte");
+    check(found(index, "data", 66, 8), "the data chunk is found by its header, not by text inside another chunk");
+    check(index.find("smpl") == nullptr, "a missing chunk isn't found");
+
+    // Cut the file off part way through the data chunk
+    bytes.resize(bytes.size() - 3);
+    check(build_both(index, bytes) && found(index, "data", 66, 8), "a truncated chunk keeps the size its header gives");
+    check(index.getSizeInFile(*index.find("data")) == 5, "only the bytes in the file count as in the file");
+
+    // A chunk claiming to be bigger than the file ends the walk
+    bytes.clear();
+    add_id(bytes, "RIFF");
+    add_size(bytes, 0, false);
+    add_id(bytes, "WAVE");
+    add_id(bytes, "junk");
+    add_size(bytes, 1000000, false);
+    add_chunk(bytes, "data", 4, "\x01");
+    check(build_both(index, bytes) && index.getChunks().size() == 1, "nothing is read past a chunk that runs off the end of the file");
+
+    bytes = { 'R', 'I', 'F' };
+    check(!build_both(index, bytes), "a file too short for a header isn't indexed");
+    bytes = { 'O', 'g', 'g', 'S', 0, 0, 0, 0, 'W', 'A', 'V', 'E' };
+    check(!build_both(index, bytes), "a file that isn't RIFF, RF64 or FORM isn't indexed");
+
+}
+
+void test_aiff(){
+
+    std::vector<uint8_t> bytes;
+    add_id(bytes, "FORM");
+    add_size(bytes, 0, true);
+    add_id(bytes, "AIFF");
+    add_chunk(bytes, "COMM", 18, "\x02", true);
+    add_chunk(bytes, "ANNO", 3, "SSND", true);
+    add_chunk(bytes, "SSND", 0x0104, "\x01", true);
+
+    AudioChunkIndex index;
+    check(build_both(index, bytes), "a FORM file is indexed");
+    check(index.getContainer() == AudioChunkIndex::Container::Form && index.getFormType() == "AIFF", "the FORM header is read");
+    check(found(index, "COMM", 20, 18), "FORM chunk sizes are big endian");
+    check(found(index, "SSND", 58, 0x0104), "a FORM chunk after an odd sized one starts after its pad byte");
+
+}
+
+int main(){
+
+test_wave();
+test_aiff();
+
+return finish("chunk index");
+}
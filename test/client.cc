@@ -0,0 +1,163 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include "elma.h"
+#include "check.h"
+
+// Runs the Client against a small HTTP server on this machine, and checks that
+// one worker sends every request over one connection, that responses reach their
+// handlers, and that requests still queued when the client is destroyed are sent
+
+using namespace elma;
+using namespace std::chrono;
+
+// Answers each request with {"request": n}, where n counts the requests so far,
+// keeping connections open between requests. Serves one connection at a time.
+class TestServer {
+
+    public:
+
+    TestServer() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        bind(listener, (sockaddr *) &address, sizeof(address));
+        listen(listener, 8);
+        getsockname(listener, (sockaddr *) &address, &length);
+        port = ntohs(address.sin_port);
+        thread = std::thread([this]() { serve(); });
+    }
+
+    ~TestServer() {
+        stopping = true;
+        thread.join();
+        close(listener);
+    }
+
+    std::string url(std::string path) {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+    int port;
+    std::atomic<int> connections{0}, requests{0};
+    std::mutex mutex;
+    std::vector<std::string> bodies;
+
+    private:
+
+    // Waits up to a tenth of a second for a socket to have something to read
+    bool readable(int fd) {
+        pollfd p = { fd, POLLIN, 0 };
+        return poll(&p, 1, 100) > 0;
+    }
+
+    void serve() {
+        while ( !stopping ) {
+            if ( !readable(listener) ) {
+                continue;
+            }
+            int connection = accept(listener, nullptr, nullptr);
+            connections++;
+            std::string data;
+            char buffer[4096];
+            while ( !stopping ) {
+                if ( !readable(connection) ) {
+                    continue;
+                }
+                ssize_t n = recv(connection, buffer, sizeof(buffer), 0);
+                if ( n <= 0 ) {
+                    break;
+                }
+                data.append(buffer, n);
+                // Answer every whole request received so far
+                size_t header_end;
+                while ( (header_end = data.find("\r\n\r\n")) != std::string::npos ) {
+                    size_t body_length = 0, length_at = data.find("Content-Length: ");
+                    if ( length_at != std::string::npos && length_at < header_end ) {
+                        body_length = std::stoul(data.substr(length_at + 16));
+                    }
+                    if ( data.size() < header_end + 4 + body_length ) {
+                        break;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        bodies.push_back(data.substr(header_end + 4, body_length));
+                    }
+                    data.erase(0, header_end + 4 + body_length);
+                    std::string body = "{\"request\":" + std::to_string(++requests) + "}";
+                    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+                                          + std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+                    send(connection, response.data(), response.size(), MSG_NOSIGNAL);
+                }
+            }
+            close(connection);
+        }
+    }
+
+    int listener;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+};
+
+int main(){
+
+// One worker reuses its connection for every request
+{
+    TestServer server;
+    Client client(1);
+    const int num_requests = 5;
+    std::vector<int> answers;
+    for ( int i = 0; i < num_requests; i++ ) {
+        client.get(server.url("/count"), [&answers](json& response) {
+            answers.push_back(response.is_object() ? response["request"].get<int>() : -1);
+        });
+    }
+    steady_clock::time_point give_up = steady_clock::now() + seconds(10);
+    while ( (int) answers.size() < num_requests && steady_clock::now() < give_up ) {
+        client.process_responses();
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+
+    check(answers == std::vector<int>({1, 2, 3, 4, 5}), "every response reaches its handler, in the order the requests were made");
+    check(server.requests == num_requests, "every request reaches the server");
+    check(server.connections == 1, "one worker sends every request over the same connection");
+    ClientStats stats = client.stats();
+    check(stats.requests_sent == num_requests && stats.requests_completed == num_requests && stats.requests_failed == 0
+          && stats.in_flight == 0, "the statistics count every request as completed");
+}
+
+// Requests still queued when the client is destroyed are sent, but their handlers aren't called
+{
+    TestServer server;
+    bool handled = false;
+    const int num_posts = 10;
+    {
+        Client client(1);
+        for ( int i = 0; i < num_posts; i++ ) {
+            client.post(server.url("/log"), json({{"post", i}}), [&handled](json&) { handled = true; });
+        }
+    }
+    check(server.requests == num_posts, "every queued request is sent before the client is destroyed");
+    bool in_order = (int) server.bodies.size() == num_posts;
+    for ( int i = 0; in_order && i < num_posts; i++ ) {
+        in_order = json::parse(server.bodies[i]) == json({{"post", i}});
+    }
+    check(in_order, "the posts arrive whole and in order");
+    check(!handled, "handlers aren't called once the client is gone");
+}
+
+return finish("client");
+}
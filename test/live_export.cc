@@ -0,0 +1,136 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include "elma.h"
+#include "SampleSplitter.h"
+#include "check.h"
+
+// Records samples longer than the live splitter's backlog, one packet per update,
+// and checks that each one is exported whole without any frames being dropped,
+// that no update takes long however long the samples are, and that the part of
+// a sample still being recorded when the splitter goes away is deleted
+
+using namespace elma;
+using namespace std::chrono;
+
+const int sample_rate = 44100;
+const int frames_per_packet = 1024;
+const int trigger_value = 30000;
+
+// Sends a signal one packet per update. The signal is set up before the run.
+class SignalSender : public Process {
+
+    public:
+
+    SignalSender() : Process("signal sender") {}
+
+    void init() {
+        audio = &audio_channel("audio");
+        bit_depth_event = event_id("set bit depth");
+        sample_rate_event = event_id("set sample rate");
+    }
+    void start() {
+        emit(bit_depth_event, Event("set bit depth", 16));
+        emit(sample_rate_event, Event("set sample rate", sample_rate));
+    }
+    void update() {
+        int start = next_packet * frames_per_packet;
+        if (start < (int) left.size()){
+            int num_frames = std::min(frames_per_packet, (int) left.size() - start);
+            std::shared_ptr<AudioPacket> packet = std::make_shared<AudioPacket>(2, num_frames);
+            packet->sequence_number = next_packet;
+            for (int i = 0; i < num_frames; i++){
+                packet->samples[2 * i] = left[start + i] / 32768.0f;
+                packet->samples[2 * i + 1] = right[start + i] / 32768.0f;
+            }
+            audio->send(packet);
+            next_packet++;
+        }
+    }
+    void stop() {}
+
+    std::vector<int16_t> left, right;
+
+    private:
+
+    AudioChannel* audio = nullptr;
+    int bit_depth_event, sample_rate_event;
+    int next_packet = 0;
+
+};
+
+bool file_exists(std::string file_name){
+    return std::ifstream(file_name).good();
+}
+
+int main(){
+
+// Four samples of 3 to 30 seconds, each started by one loud frame and quiet after it,
+// then the start of a fifth that never ends
+std::vector<int> sample_lengths = {30 * sample_rate, 4 * sample_rate, 6 * sample_rate + 17, 7 * sample_rate / 2};
+std::vector<int> sample_starts;
+SignalSender sender;
+for (int length : sample_lengths){
+    sample_starts.push_back(sender.left.size());
+    for (int i = 0; i < length; i++){
+        sender.left.push_back(i == 0 ? trigger_value : (int16_t) ((i * 7) % 16000 - 8000));
+        sender.right.push_back((int16_t) ((i * 13 + sample_starts.size()) % 12000 - 6000));
+    }
+}
+for (int i = 0; i < sample_rate; i++){
+    sender.left.push_back(i == 0 ? trigger_value : 0);
+    sender.right.push_back(0);
+}
+int num_packets = (sender.left.size() + frames_per_packet - 1) / frames_per_packet;
+
+ProcessStats stats("sample splitter");
+long dropped_frames;
+{
+    Manager m;
+    AudioChannel audio("audio");
+    // A three second grace time gives a backlog of about 24 seconds, shorter than the first sample. Frames that don't fit
+    // are dropped rather than spilled, so a sample that outgrew the backlog would come out short. Like the
+    // splitter in test.cc it only looks for samples every 30 updates. The export queues are long enough that
+    // it never waits for the export threads, so its updates are timed on their own.
+    BasicSampleSplitter<int16_t> splitter(0.5, 3, 30, BacklogOverflow::DropOldest, 2, 64);
+
+    m.schedule(sender, 23219_us)
+     .schedule(splitter, 23219_us)
+     .set_clock_mode(Manager::SIMULATED)
+     .add_channel(audio)
+     .init()
+     .run(23219_us * (num_packets + 2));
+
+    stats = splitter.stats();
+    dropped_frames = splitter.get_dropped_frames();
+}
+
+check(dropped_frames == 0, "samples longer than the backlog are written as they're recorded, so no frames are dropped");
+
+for (size_t n = 0; n < sample_lengths.size(); n++){
+    std::string file_name = "sample_" + std::to_string(n + 1) + ".wav";
+    AudioFile<int16_t> sample;
+    bool matches = sample.load(file_name) && sample.getNumChannels() == 2 && sample.getSampleRate() == sample_rate
+                && sample.getNumSamplesPerChannel() == sample_lengths[n];
+    for (int i = 0; matches && i < sample_lengths[n]; i++){
+        matches = sample.samples[0][i] == sender.left[sample_starts[n] + i] && sample.samples[1][i] == sender.right[sample_starts[n] + i];
+    }
+    check(matches, file_name + " holds exactly its part of the recording");
+    std::remove(file_name.c_str());
+}
+
+check(!file_exists("sample_5.wav"), "the sample still being recorded is deleted when the splitter goes away");
+std::remove("sample_5.wav");
+
+// An update only scans and copies the audio that arrived since the last attempt, so even on a slow build
+// it finishes well within the time it takes a packet to arrive. Copying a whole sample at once doesn't.
+long max_update_us = duration_cast<microseconds>(stats.max_duration()).count();
+check(stats.overruns() == 0 && stats.max_duration() < stats.period(),
+      "every update finishes within its period, but the slowest took " + std::to_string(max_update_us) + " us");
+
+return finish("live export");
+}
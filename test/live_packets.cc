@@ -0,0 +1,137 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include "elma.h"
+#include "SampleSplitter.h"
+#include "check.h"
+
+// Runs a live splitter slower than the process sending it audio, through a
+// channel too small to hold every packet sent between its updates, and checks
+// that the missed and duplicate packets are counted and that every packet it
+// did read is exported whole and in order
+
+using namespace elma;
+
+const int frames_per_packet = 64;
+const int trigger_value = 30000;
+
+// Sends a fixed number of numbered packets, one per update, re-sending some of them.
+// Every packet starts with a frame loud enough to start a sample, so the splitter
+// exports each packet it reads as a sample of its own. The rest of the left channel
+// holds the packet's sequence number and the right channel holds the frame number.
+class PacketSender : public Process {
+
+    public:
+
+    PacketSender(int num_packets) : Process("packet sender"), num_packets(num_packets) {}
+
+    void init() {
+        audio = &audio_channel("audio");
+        bit_depth_event = event_id("set bit depth");
+        sample_rate_event = event_id("set sample rate");
+    }
+    void start() {
+        emit(bit_depth_event, Event("set bit depth", 16));
+        emit(sample_rate_event, Event("set sample rate", 44100));
+    }
+    void update() {
+        if (next < num_packets){
+            audio->send(make_packet(next));
+            // Send the previous packet again, or this one twice
+            if (next % 5 == 4){
+                audio->send(make_packet(next - 1));
+                num_resent++;
+            } else if (next % 7 == 6){
+                audio->send(make_packet(next));
+                num_resent++;
+            }
+            next++;
+        }
+    }
+    void stop() {}
+
+    int num_packets, next = 0, num_resent = 0;
+
+    private:
+
+    AudioPacketPtr make_packet(int sequence_number){
+        std::shared_ptr<AudioPacket> packet = std::make_shared<AudioPacket>(2, frames_per_packet);
+        packet->sequence_number = sequence_number;
+        for (int i = 0; i < frames_per_packet; i++){
+            packet->samples[2 * i] = (i == 0 ? trigger_value : sequence_number) / 32768.0f;
+            packet->samples[2 * i + 1] = i * 100 / 32768.0f;
+        }
+        return packet;
+    }
+
+    AudioChannel* audio = nullptr;
+    int bit_depth_event, sample_rate_event;
+
+};
+
+bool file_exists(std::string file_name){
+    return std::ifstream(file_name).good();
+}
+
+int main(){
+
+const int num_packets = 200;
+
+Manager m;
+AudioChannel audio("audio", 3);
+PacketSender sender(num_packets);
+// A grace time of 10 frames, so each packet's trigger starts a new sample
+BasicSampleSplitter<int16_t> splitter(0.5, 10.5 / 44100, 0);
+
+// The splitter reads every fifth packet's worth of time, through a channel that holds three,
+// and keeps updating after the sender has finished so it reads the last packet
+m.schedule(sender, 1_ms)
+ .schedule(splitter, 5_ms)
+ .set_clock_mode(Manager::SIMULATED)
+ .add_channel(audio)
+ .init()
+ .run(300_ms);
+
+check(audio.duplicates() == sender.num_resent && splitter.get_duplicate_packets() == sender.num_resent,
+      "every re-sent packet is dropped by the channel and counted as a duplicate");
+
+// The packets read, oldest first. The last one starts the sample still being recorded,
+// so only the ones before it are exported.
+std::vector<int> read;
+bool whole = true;
+for (int i = 1; file_exists("sample_" + std::to_string(i) + ".wav"); i++){
+    std::string file_name = "sample_" + std::to_string(i) + ".wav";
+    AudioFile<int16_t> sample;
+    bool loaded = sample.load(file_name) && sample.getNumChannels() == 2 && sample.getNumSamplesPerChannel() == frames_per_packet;
+    int sequence_number = loaded ? sample.samples[0][1] : -1;
+    for (int frame = 0; loaded && frame < frames_per_packet; frame++){
+        loaded = sample.samples[0][frame] == (frame == 0 ? trigger_value : sequence_number)
+              && sample.samples[1][frame] == frame * 100;
+    }
+    whole = whole && loaded;
+    read.push_back(sequence_number);
+    std::remove(file_name.c_str());
+}
+read.push_back(num_packets - 1);
+
+check(read.size() > 1, "samples are exported");
+check(whole, "each exported sample is exactly one packet's audio");
+
+bool in_order = true, some_consecutive = false;
+long gaps = read[0];
+for (size_t i = 1; i < read.size(); i++){
+    in_order = in_order && read[i] > read[i - 1];
+    some_consecutive = some_consecutive || read[i] == read[i - 1] + 1;
+    gaps += read[i] - read[i - 1] - 1;
+}
+check(in_order, "packets are read once each, in order");
+check(some_consecutive, "several packets are read in one update");
+check(gaps > 0, "packets that leave the channel before the splitter updates are missed");
+check(splitter.get_missed_packets() == gaps, "every missed packet is counted");
+check(splitter.get_dropped_frames() == 0, "no frames are dropped from the backlog");
+
+return finish("live packet");
+}
@@ -0,0 +1,280 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include "PcmKernels.h"
+#include "check.h"
+
+// Checks that every instruction set the CPU supports decodes and encodes
+// exactly the same samples and bytes as the scalar kernels, which are checked
+// against the formats themselves, over odd lengths and misaligned buffers
+
+struct FormatInfo {
+    PcmFormat format;
+    std::string name;
+    int num_bits;
+    bool is_big_endian;
+    bool is_unsigned;
+};
+
+const FormatInfo formats[] = {
+    { PcmFormat::UInt8, "unsigned 8-bit", 8, false, true },
+    { PcmFormat::Int8, "signed 8-bit", 8, true, false },
+    { PcmFormat::Int16LittleEndian, "16-bit little endian", 16, false, false },
+    { PcmFormat::Int16BigEndian, "16-bit big endian", 16, true, false },
+    { PcmFormat::Int24LittleEndian, "24-bit little endian", 24, false, false },
+    { PcmFormat::Int24BigEndian, "24-bit big endian", 24, true, false },
+};
+
+// Lengths either side of the 4 and 8 frame groups the SIMD kernels work in
+const int lengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 1001 };
+
+// The instruction sets this CPU can run
+std::vector<PcmInstructionSet> available_instruction_sets(){
+    std::vector<PcmInstructionSet> sets;
+    for (PcmInstructionSet set : { PcmInstructionSet::Scalar, PcmInstructionSet::SSE2, PcmInstructionSet::AVX2 }){
+        if (PcmKernels::setInstructionSet(set) == set){
+            sets.push_back(set);
+        }
+    }
+    return sets;
+}
+
+// A pseudo-random byte, with plenty of the extreme values thrown in
+uint8_t random_byte(unsigned& seed){
+    seed = seed * 1103515245 + 12345;
+    const uint8_t extremes[] = { 0x00, 0x7F, 0x80, 0xFF };
+    return (seed >> 28) < 4 ? extremes[(seed >> 16) & 3] : (uint8_t) (seed >> 16);
+}
+
+// Reads the sample at p as a signed integer, straight from the format's definition
+int32_t read_pcm(const uint8_t* p, const FormatInfo& info){
+    int num_bytes = info.num_bits / 8;
+    uint32_t value = 0;
+    for (int i = 0; i < num_bytes; i++){
+        value = (value << 8) | p[info.is_big_endian ? i : num_bytes - 1 - i];
+    }
+    if (info.is_unsigned){
+        return (int32_t) value - (1 << (info.num_bits - 1));
+    }
+    return (int32_t) (value << (32 - info.num_bits)) >> (32 - info.num_bits);
+}
+
+// Floating point samples are the PCM value over full scale
+template <class T>
+T expected_sample(int32_t value, int num_bits, std::false_type /* isInteger */){
+    return (T) ((double) value / (double) (1 << (num_bits - 1)));
+}
+
+// Integer samples are the PCM value left justified in T
+template <class T>
+T expected_sample(int32_t value, int num_bits, std::true_type /* isInteger */){
+    int shift = 8 * (int) sizeof(T) - num_bits;
+    return (T) (shift >= 0 ? (int64_t) value * ((int64_t) 1 << shift) : value >> -shift);
+}
+
+// Writes a PCM value as the format stores it
+void write_pcm(int32_t value, uint8_t* p, const FormatInfo& info){
+    int num_bytes = info.num_bits / 8;
+    for (int i = 0; i < num_bytes; i++){
+        p[info.is_big_endian ? num_bytes - 1 - i : i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+// Floating point samples are clamped in their own precision, then scaled in double precision and truncated
+template <class T>
+int32_t expected_pcm(T sample, const FormatInfo& info, std::false_type /* isInteger */){
+    double max_value = info.num_bits == 24 ? 8388607. / 8388608. : 1.;
+    double scale = info.is_unsigned ? 255. : info.num_bits == 8 ? 127. : info.num_bits == 16 ? 32767. : 8388608.;
+    sample = std::max(std::min(sample, (T) max_value), (T) -1.);
+    if (info.is_unsigned){
+        sample = (sample + (T) 1.) * (T) 0.5;
+    }
+    return (int32_t) ((double) sample * scale);
+}
+
+// Integer samples are shifted down to the bit depth
+template <class T>
+int32_t expected_pcm(T sample, const FormatInfo& info, std::true_type /* isInteger */){
+    int shift = 8 * (int) sizeof(T) - info.num_bits;
+    int32_t value = shift >= 0 ? (int32_t) (sample >> shift) : (int32_t) sample * (1 << -shift);
+    return info.is_unsigned ? value + 128 : value;
+}
+
+// A pseudo-random floating point sample, mostly from -1.5 to 1.5 so some are clipped,
+// with full scale, zero and values just either side of them thrown in
+template <class T>
+T random_sample(unsigned& seed, std::false_type /* isInteger */){
+    seed = seed * 1103515245 + 12345;
+    const T extremes[] = { (T) 1., (T) -1., (T) 0., (T) 0.99999994, (T) -0.99999994, (T) 1e-9, (T) -1e-9, (T) 8388607. / (T) 8388608. };
+    if ((seed >> 28) < 4){
+        return extremes[(seed >> 16) & 7];
+    }
+    return (T) (((seed >> 8) & 0xFFFF) / 65535.0 * 3.0 - 1.5);
+}
+
+// A pseudo-random integer sample, with the extremes of the type thrown in
+template <class T>
+T random_sample(unsigned& seed, std::true_type /* isInteger */){
+    seed = seed * 1103515245 + 12345;
+    if ((seed >> 28) < 3){
+        const T extremes[] = { std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest(), (T) 0 };
+        return extremes[((seed >> 16) & 0xFF) % 3];
+    }
+    unsigned more = seed * 1103515245 + 12345;
+    return (T) (((int64_t) seed << 16) ^ (int64_t) more);
+}
+
+// Whether two runs of samples hold exactly the same bits
+template <class T>
+bool same_bits(const std::vector<T>& a, const std::vector<T>& b){
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+template <class T>
+void test_decode(const std::vector<PcmInstructionSet>& instruction_sets, std::string type_name){
+
+    unsigned seed = 1;
+    const T guard = (T) 99;
+
+    for (const FormatInfo& info : formats){
+        int num_bytes = PcmKernels::getNumBytesPerSample(info.format);
+        check(num_bytes == info.num_bits / 8, info.name + " samples are " + std::to_string(info.num_bits / 8) + " bytes");
+
+        for (int num_channels = 1; num_channels <= 3; num_channels++){
+            for (int num_frames : lengths){
+                // The source starts 0 to 3 bytes into its allocation, and the channels 1 sample
+                // into theirs, so neither is aligned however the allocations fall
+                for (int offset = 0; offset < 4; offset++){
+
+                    std::string what = type_name + ", " + info.name + ", " + std::to_string(num_channels) + " channels, "
+                                     + std::to_string(num_frames) + " frames, offset " + std::to_string(offset);
+
+                    std::vector<uint8_t> bytes(offset + (size_t) num_frames * num_channels * num_bytes);
+                    for (uint8_t& byte : bytes){
+                        byte = random_byte(seed);
+                    }
+                    const uint8_t* source = bytes.data() + offset;
+
+                    // The scalar kernels must match the format itself
+                    std::vector<std::vector<T>> reference(num_channels, std::vector<T>(num_frames + 2, guard));
+                    std::vector<T*> reference_pointers;
+                    for (auto& channel : reference){
+                        reference_pointers.push_back(channel.data() + 1);
+                    }
+                    PcmKernels::setInstructionSet(PcmInstructionSet::Scalar);
+                    PcmKernels::decode(source, info.format, num_channels, num_frames, reference_pointers.data());
+
+                    bool right = true;
+                    for (int channel = 0; channel < num_channels; channel++){
+                        right = right && reference[channel][0] == guard && reference[channel][num_frames + 1] == guard;
+                        for (int i = 0; i < num_frames; i++){
+                            int32_t value = read_pcm(source + ((size_t) i * num_channels + channel) * num_bytes, info);
+                            right = right && reference[channel][i + 1] == expected_sample<T>(value, info.num_bits, std::is_integral<T>());
+                        }
+                    }
+                    check(right, "scalar decode: " + what);
+
+                    // Every other instruction set must match the scalar kernels bit for bit
+                    for (PcmInstructionSet set : instruction_sets){
+                        std::vector<std::vector<T>> decoded(num_channels, std::vector<T>(num_frames + 2, guard));
+                        std::vector<T*> pointers;
+                        for (auto& channel : decoded){
+                            pointers.push_back(channel.data() + 1);
+                        }
+                        PcmKernels::setInstructionSet(set);
+                        PcmKernels::decode(source, info.format, num_channels, num_frames, pointers.data());
+                        bool same = true;
+                        for (int channel = 0; channel < num_channels; channel++){
+                            same = same && same_bits(decoded[channel], reference[channel]);
+                        }
+                        check(same, std::string(PcmKernels::getInstructionSetName(set)) + " decode matches scalar: " + what);
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+template <class T>
+void test_encode(const std::vector<PcmInstructionSet>& instruction_sets, std::string type_name){
+
+    unsigned seed = 2;
+    const uint8_t guard = 0xA5;
+
+    for (const FormatInfo& info : formats){
+        int num_bytes = PcmKernels::getNumBytesPerSample(info.format);
+
+        for (int num_channels = 1; num_channels <= 3; num_channels++){
+            for (int num_frames : lengths){
+                // The destination starts 0 to 3 bytes into its allocation, and the channels 1 sample into theirs
+                for (int offset = 0; offset < 4; offset++){
+
+                    std::string what = type_name + ", " + info.name + ", " + std::to_string(num_channels) + " channels, "
+                                     + std::to_string(num_frames) + " frames, offset " + std::to_string(offset);
+
+                    std::vector<std::vector<T>> samples(num_channels, std::vector<T>(num_frames + 1));
+                    std::vector<const T*> pointers;
+                    for (auto& channel : samples){
+                        for (T& sample : channel){
+                            sample = random_sample<T>(seed, std::is_integral<T>());
+                        }
+                        pointers.push_back(channel.data() + 1);
+                    }
+                    size_t num_data_bytes = (size_t) num_frames * num_channels * num_bytes;
+
+                    // The scalar kernels must match the format itself
+                    std::vector<uint8_t> reference(offset + num_data_bytes + 1, guard);
+                    PcmKernels::setInstructionSet(PcmInstructionSet::Scalar);
+                    PcmKernels::encode(pointers.data(), info.format, num_channels, num_frames, reference.data() + offset);
+
+                    std::vector<uint8_t> expected(offset + num_data_bytes + 1, guard);
+                    for (int channel = 0; channel < num_channels; channel++){
+                        for (int i = 0; i < num_frames; i++){
+                            int32_t value = expected_pcm<T>(pointers[channel][i], info, std::is_integral<T>());
+                            write_pcm(value, expected.data() + offset + ((size_t) i * num_channels + channel) * num_bytes, info);
+                        }
+                    }
+                    check(reference == expected, "scalar encode: " + what);
+
+                    // Every other instruction set must write exactly the same bytes
+                    for (PcmInstructionSet set : instruction_sets){
+                        std::vector<uint8_t> encoded(offset + num_data_bytes + 1, guard);
+                        PcmKernels::setInstructionSet(set);
+                        PcmKernels::encode(pointers.data(), info.format, num_channels, num_frames, encoded.data() + offset);
+                        check(encoded == reference, std::string(PcmKernels::getInstructionSetName(set)) + " encode matches scalar: " + what);
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+int main(){
+
+std::vector<PcmInstructionSet> instruction_sets = available_instruction_sets();
+std::cout << "Comparing";
+for (PcmInstructionSet set : instruction_sets){
+    std::cout << " " << PcmKernels::getInstructionSetName(set);
+}
+std::cout << std::endl;
+
+test_decode<float>(instruction_sets, "float");
+test_decode<double>(instruction_sets, "double");
+test_decode<int16_t>(instruction_sets, "int16_t");
+test_decode<int32_t>(instruction_sets, "int32_t");
+test_encode<float>(instruction_sets, "float");
+test_encode<double>(instruction_sets, "double");
+test_encode<int16_t>(instruction_sets, "int16_t");
+test_encode<int32_t>(instruction_sets, "int32_t");
+
+PcmKernels::setInstructionSet(PcmInstructionSet::AVX2);
+
+return finish("PCM kernel");
+}
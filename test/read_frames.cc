@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <stdint.h>
+#include "AudioFile.h"
+#include "check.h"
+
+// Checks that AudioFile::readFrames on a header-only file gives the same
+// frames as a slice of the fully loaded file, including from copies of the
+// AudioFile reading on different threads
+
+const int64_t num_frames = 100000;
+
+// Whether frames holds the num_read frames of the full file starting at start_frame
+bool matches_slice(const AudioFile<int16_t>& full, const PlanarAudioBuffer<int16_t>& frames, int64_t start_frame, int64_t num_read){
+    for (int channel = 0; channel < 2; channel++){
+        for (int64_t i = 0; i < num_read; i++){
+            if (frames[channel][i] != full.samples[channel][start_frame + i]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Reads a range and checks it against the full file
+void check_range(AudioFile<int16_t>& audio_file, const AudioFile<int16_t>& full, int64_t start_frame, int64_t num_frames_asked,
+                 int64_t num_frames_expected, std::string what){
+    PlanarAudioBuffer<int16_t> frames(2, 5000);
+    int64_t num_read = audio_file.readFrames(start_frame, num_frames_asked, frames.getView());
+    check(num_read == num_frames_expected && matches_slice(full, frames, start_frame, num_read), what);
+}
+
+void check_ranges(AudioFile<int16_t>& audio_file, const AudioFile<int16_t>& full, std::string mode){
+    check_range(audio_file, full, 0, 1000, 1000, mode + ": the first frames");
+    check_range(audio_file, full, 54321, 777, 777, mode + ": frames from the middle");
+    check_range(audio_file, full, 12, 1, 1, mode + ": a single frame");
+    check_range(audio_file, full, num_frames - 300, 1000, 300, mode + ": a range running past the end stops at the end");
+    check_range(audio_file, full, 20000, 9000, 5000, mode + ": a range bigger than the destination fills it");
+    check_range(audio_file, full, num_frames, 10, 0, mode + ": nothing is read at the end");
+    check_range(audio_file, full, num_frames + 10, 10, 0, mode + ": nothing is read past the end");
+    check_range(audio_file, full, -1, 10, 0, mode + ": nothing is read before the start");
+    check_range(audio_file, full, 3000, 0, 0, mode + ": nothing is read when nothing is asked for");
+}
+
+// Reads pseudo-random ranges, checking each, and returns how many were wrong
+int read_random_ranges(AudioFile<int16_t> audio_file, const AudioFile<int16_t>& full, unsigned seed){
+    PlanarAudioBuffer<int16_t> frames(2, 512);
+    int wrong = 0;
+    for (int i = 0; i < 2000; i++){
+        seed = seed * 1103515245 + 12345;
+        int64_t start_frame = (seed >> 8) % (num_frames - 512);
+        if (audio_file.readFrames(start_frame, 512, frames.getView()) != 512 || !matches_slice(full, frames, start_frame, 512)){
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+int main(){
+
+// A 16-bit stereo test file with a different value in every sample
+PlanarAudioBuffer<int16_t> signal(2, num_frames);
+for (int64_t i = 0; i < num_frames; i++){
+    signal[0][i] = (int16_t) (i * 7);
+    signal[1][i] = (int16_t) (i * -13 + 5);
+}
+AudioFileWriter<int16_t> writer;
+check(writer.open("read_frames_test.wav", 2, 44100, 16) && writer.write(signal.getView()) && writer.close(), "the test file is written");
+
+AudioFile<int16_t> full;
+check(full.load("read_frames_test.wav") && full.getNumSamplesPerChannel() == num_frames, "the test file is loaded");
+
+AudioFile<int16_t> header_only;
+check(header_only.load("read_frames_test.wav", AudioFileLoadMode::HeaderOnly), "the test file is opened header-only");
+check(header_only.isHeaderOnly() && header_only.samples.getNumFrames() == 0, "a header-only file holds no samples");
+check(header_only.getNumSamplesPerChannel() == num_frames && header_only.getNumChannels() == 2, "a header-only file knows its size");
+
+check_ranges(header_only, full, "header-only");
+check_ranges(full, full, "loaded");
+
+// Copies share the open file, but their reads mustn't get in each other's way
+AudioFile<int16_t> copy = header_only;
+int wrong_on_thread = 0;
+std::thread reader([&]() { wrong_on_thread = read_random_ranges(copy, full, 1); });
+int wrong_here = read_random_ranges(header_only, full, 2);
+reader.join();
+check(wrong_on_thread == 0 && wrong_here == 0, "copies read the right frames on different threads at once");
+
+std::remove("read_frames_test.wav");
+
+return finish("readFrames");
+}
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <stdint.h>
+#include "AudioFile.h"
+#include "AudioChunkIndex.h"
+#include "check.h"
+
+// Checks that RF64 files are read using the 64-bit sizes in their ds64 chunk,
+// and that AudioFileWriter turns its JUNK chunk into a ds64 chunk when it
+// writes RF64. Real RF64 files are over 4GB, so these use small files that
+// are RF64 anyway.
+
+void add_int(std::vector<uint8_t>& bytes, uint64_t value, int num_bytes){
+    for (int i = 0; i < num_bytes; i++){
+        bytes.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t get_int(const std::vector<uint8_t>& bytes, size_t index, int num_bytes){
+    uint64_t value = 0;
+    for (int i = num_bytes - 1; i >= 0; i--){
+        value = (value << 8) | bytes[index + i];
+    }
+    return value;
+}
+
+std::vector<uint8_t> read_file(std::string file_name){
+    std::ifstream file(file_name, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void write_file(std::string file_name, const std::vector<uint8_t>& bytes){
+    std::ofstream file(file_name, std::ios::binary);
+    file.write((const char*) bytes.data(), bytes.size());
+}
+
+// A test signal for frame i of a channel
+int16_t test_sample(int channel, int64_t i){
+    return (int16_t) (channel == 0 ? i * 37 - 16000 : 12000 - i * 23);
+}
+
+bool holds_test_signal(const AudioFile<int16_t>& audio_file, int64_t num_frames){
+    bool same = audio_file.getNumChannels() == 2 && audio_file.getNumSamplesPerChannel() == num_frames;
+    for (int64_t i = 0; same && i < num_frames; i++){
+        same = audio_file.samples[0][i] == test_sample(0, i) && audio_file.samples[1][i] == test_sample(1, i);
+    }
+    return same;
+}
+
+// A 16-bit stereo RF64 file whose data and LIST chunks give their sizes only in the ds64 chunk
+void test_reading_rf64(){
+
+    const int64_t num_frames = 1000;
+    const uint64_t data_size = num_frames * 4;
+
+    std::vector<uint8_t> bytes;
+    add_id(bytes, "RF64");
+    add_int(bytes, 0xFFFFFFFF, 4);
+    add_id(bytes, "WAVE");
+    add_id(bytes, "ds64");
+    add_int(bytes, 40, 4);
+    add_int(bytes, 0, 8); // riff size, filled in below
+    add_int(bytes, data_size, 8);
+    add_int(bytes, num_frames, 8);
+    add_int(bytes, 1, 4); // table length
+    add_id(bytes, "LIST");
+    add_int(bytes, 6, 8);
+    add_id(bytes, "fmt ");
+    add_int(bytes, 16, 4);
+    add_int(bytes, 1, 2); // PCM
+    add_int(bytes, 2, 2); // channels
+    add_int(bytes, 44100, 4);
+    add_int(bytes, 44100 * 4, 4);
+    add_int(bytes, 4, 2); // bytes per frame
+    add_int(bytes, 16, 2);
+    add_id(bytes, "data");
+    add_int(bytes, 0xFFFFFFFF, 4);
+    for (int64_t i = 0; i < num_frames; i++){
+        add_int(bytes, (uint16_t) test_sample(0, i), 2);
+        add_int(bytes, (uint16_t) test_sample(1, i), 2);
+    }
+    add_id(bytes, "LIST");
+    add_int(bytes, 0xFFFFFFFF, 4);
+    add_id(bytes, "INFOab");
+    for (int i = 0; i < 8; i++){
+        bytes[20 + i] = ((bytes.size() - 8) >> (8 * i)) & 0xFF;
+    }
+
+    AudioChunkIndex index;
+    check(index.build(bytes.data(), bytes.size()), "an RF64 file is indexed");
+    check(index.getContainer() == AudioChunkIndex::Container::Rf64, "RF64 is recognised");
+    check(index.find("data") != nullptr && index.find("data")->size == data_size, "the data size comes from the ds64 chunk");
+    check(index.find("LIST") != nullptr && index.find("LIST")->size == 6, "other sizes come from the ds64 table");
+
+    bytes[0] = 'B'; bytes[1] = 'W';
+    check(index.build(bytes.data(), bytes.size()) && index.find("data")->size == data_size, "BW64 is read the same way");
+
+    write_file("rf64_test_read.wav", bytes);
+
+    AudioFile<int16_t> audio_file;
+    check(audio_file.load("rf64_test_read.wav") && holds_test_signal(audio_file, num_frames), "an RF64 file is loaded");
+    check(audio_file.load("rf64_test_read.wav", AudioFileLoadMode::ReadIntoMemory) && holds_test_signal(audio_file, num_frames), "an RF64 file is read into memory");
+
+    AudioFileReader<int16_t> reader;
+    PlanarAudioBuffer<int16_t> frames(2, num_frames);
+    check(reader.open("rf64_test_read.wav") && reader.getNumSamplesPerChannel() == num_frames, "an RF64 file is opened for streaming");
+    check(reader.read(frames.getView()) == num_frames && frames[0][999] == test_sample(0, 999), "an RF64 file is streamed");
+    reader.close();
+
+    std::remove("rf64_test_read.wav");
+
+}
+
+// Writes the test signal with AudioFileWriter, as RF64 or not
+std::vector<uint8_t> write_test_signal(std::string file_name, int64_t num_frames, bool rf64){
+    PlanarAudioBuffer<int16_t> frames(2, num_frames);
+    for (int64_t i = 0; i < num_frames; i++){
+        frames[0][i] = test_sample(0, i);
+        frames[1][i] = test_sample(1, i);
+    }
+    AudioFileWriter<int16_t> writer;
+    writer.setAlwaysRf64(rf64);
+    bool written = writer.open(file_name, 2, 44100, 16)
+                && writer.write(frames.getFrames(0, num_frames / 3))
+                && writer.write(frames.getFrames(num_frames / 3, num_frames - num_frames / 3))
+                && writer.close();
+    check(written, "the test signal is written");
+    return read_file(file_name);
+}
+
+void test_writing_rf64(){
+
+    const int64_t num_frames = 5001;
+    const uint64_t data_size = num_frames * 4;
+
+    // Without RF64, the header keeps its JUNK chunk
+    std::vector<uint8_t> bytes = write_test_signal("rf64_test_riff.wav", num_frames, false);
+    check(bytes.size() == 80 + data_size, "a RIFF file is the header plus the data");
+    check(std::string(bytes.begin(), bytes.begin() + 4) == "RIFF" && get_int(bytes, 4, 4) == bytes.size() - 8, "the RIFF size");
+    check(std::string(bytes.begin() + 12, bytes.begin() + 16) == "JUNK" && get_int(bytes, 16, 4) == 28, "room for a ds64 chunk is kept as JUNK");
+    check(std::string(bytes.begin() + 72, bytes.begin() + 76) == "data" && get_int(bytes, 76, 4) == data_size, "the data size");
+
+    // With RF64, the JUNK chunk becomes a ds64 chunk, and the rest of the file doesn't move
+    std::vector<uint8_t> rf64_bytes = write_test_signal("rf64_test_rf64.wav", num_frames, true);
+    check(rf64_bytes.size() == bytes.size(), "an RF64 file is the same size as a RIFF one");
+    check(std::string(rf64_bytes.begin(), rf64_bytes.begin() + 4) == "RF64" && get_int(rf64_bytes, 4, 4) == 0xFFFFFFFF, "the RF64 header");
+    check(std::string(rf64_bytes.begin() + 12, rf64_bytes.begin() + 16) == "ds64" && get_int(rf64_bytes, 16, 4) == 28, "the ds64 chunk replaces the JUNK chunk");
+    check(get_int(rf64_bytes, 20, 8) == rf64_bytes.size() - 8, "the ds64 riff size");
+    check(get_int(rf64_bytes, 28, 8) == data_size, "the ds64 data size");
+    check(get_int(rf64_bytes, 36, 8) == (uint64_t) num_frames, "the ds64 sample count");
+    check(get_int(rf64_bytes, 44, 4) == 0, "the ds64 table is empty");
+    check(get_int(rf64_bytes, 76, 4) == 0xFFFFFFFF, "the data chunk's 32-bit size says to look in the ds64 chunk");
+    check(std::equal(bytes.begin() + 48, bytes.begin() + 76, rf64_bytes.begin() + 48)
+          && std::equal(bytes.begin() + 80, bytes.end(), rf64_bytes.begin() + 80), "the format and audio are the same as a RIFF file's");
+
+    AudioFile<int16_t> audio_file;
+    check(audio_file.load("rf64_test_rf64.wav") && holds_test_signal(audio_file, num_frames), "a written RF64 file loads bit for bit");
+    check(audio_file.load("rf64_test_riff.wav") && holds_test_signal(audio_file, num_frames), "a written RIFF file loads bit for bit");
+
+    std::remove("rf64_test_riff.wav");
+    std::remove("rf64_test_rf64.wav");
+
+}
+
+int main(){
+
+test_reading_rf64();
+test_writing_rf64();
+
+return finish("RF64");
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AudioRingBuffer.h"
+#include "check.h"
+
+// Checks that AudioRingBuffer hands back exactly what was written, in order,
+// including frames that wrap around the end of its storage
+
+// Writes frames first_value, first_value + 1, ... to both channels, with the right channel negated
+int write_counting(AudioRingBuffer<double>& ring, int first_value, int num_frames){
+    std::vector<double> left, right;
+    for (int i = 0; i < num_frames; i++){
+        left.push_back(first_value + i);
+        right.push_back(-(first_value + i));
+    }
+    const double* channels[] = { left.data(), right.data() };
+    return ring.write(channels, num_frames);
+}
+
+// Whether a view holds first_value, first_value + 1, ... as written by write_counting
+bool holds_counting(const AudioBufferView<const double>& view, int first_value){
+    for (int64_t i = 0; i < view.getNumFrames(); i++){
+        if (view[0][i] != first_value + i || view[1][i] != -(first_value + i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+
+AudioRingBuffer<double> ring(2, 5);
+check(ring.getCapacity() == 8, "capacity is rounded up to a power of two");
+check(ring.getNumReady() == 0 && ring.getFreeSpace() == 8, "a new ring is empty");
+
+// Fill it, asking for more than fits
+check(write_counting(ring, 0, 10) == 8, "a write stops when the ring is full");
+check(ring.getFreeSpace() == 0 && ring.getNumReady() == 8, "a full ring has no free space");
+check(write_counting(ring, 100, 1) == 0, "nothing is written to a full ring");
+
+AudioBufferView<const double> first, second;
+ring.getFrames(0, 8, first, second);
+check(first.getNumFrames() == 8 && second.getNumFrames() == 0, "frames that don't wrap come back in one view");
+check(holds_counting(first, 0), "a full ring holds what was written");
+
+// Leave two frames unread, so the next write wraps around the end of the storage
+ring.discard(6);
+check(ring.getNumReady() == 2 && ring.getFreeSpace() == 6, "discarding frees space");
+check(write_counting(ring, 8, 5) == 5, "a write that wraps fits in the free space");
+check(ring.getNumReady() == 7, "wrapped frames are ready");
+
+ring.getFrames(0, 7, first, second);
+check(first.getNumFrames() == 2 && second.getNumFrames() == 5, "wrapped frames come back in two views");
+check(holds_counting(first, 6) && holds_counting(second, 8), "wrapped frames keep their order");
+
+bool samples_in_order = true;
+for (int i = 0; i < ring.getNumReady(); i++){
+    samples_in_order = samples_in_order && ring.getSample(0, i) == 6 + i && ring.getSample(1, i) == -(6 + i);
+}
+check(samples_in_order, "getSample reads across the wrap point");
+
+// A range that starts after the wrap point comes back in one view
+ring.getFrames(3, 4, first, second);
+check(first.getNumFrames() == 4 && second.getNumFrames() == 0 && holds_counting(first, 9), "frames after the wrap point");
+
+// Keep writing and reading in odd sized steps, going round the ring many times
+bool in_order = true;
+int next_written = 13, next_read = 6;
+for (int step = 0; step < 1000; step++){
+    next_written += write_counting(ring, next_written, step % 7);
+    int num_to_read = std::min(ring.getNumReady(), step % 5 + 1);
+    ring.getFrames(0, num_to_read, first, second);
+    in_order = in_order && holds_counting(first, next_read) && holds_counting(second, next_read + (int) first.getNumFrames());
+    ring.discard(num_to_read);
+    next_read += num_to_read;
+}
+check(in_order, "frames come out in the order they went in, round after round");
+check(ring.getNumReady() == next_written - next_read, "every frame written is read or still ready");
+
+return finish("ring buffer");
+}
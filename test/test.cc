@@ -23,8 +23,7 @@ double grace_time = 3;
 double upea = 30;
 
 elma::Manager m;
-Channel lft_a("left audio");
-Channel rght_a("right audio");
+AudioChannel audio("audio");
 
 // Testing Live Mode
 // --------------------------------------------------------------------------
@@ -35,10 +34,13 @@ SampleSplitter ss(threshold, grace_time, upea);
 std::cout << "Testing the sample splitter in live mode" <<std::endl;
 std::cout << "Recording" <<std::endl;
 
+// The simulated clock skips the waits between updates, so the 26 seconds of
+// recording are replayed as fast as the splitter can keep up
 m.schedule(rec, 23219_us)
 .schedule(ss, 23219_us)
-.add_channel(lft_a)
-.add_channel(rght_a)
+.set_clock_mode(Manager::SIMULATED)
+.set_print_stats(true)
+.add_channel(audio)
 .init()
 .start()
 .run(26_s);
@@ -0,0 +1,227 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "elma.h"
+#include "check.h"
+
+// Checks how the Manager orders and groups processes that depend on each other,
+// that it refuses dependencies that form a cycle, and that in THREADED mode each
+// group runs on its own thread, events are handled on the emitter's thread, and
+// a process that throws stops every thread
+
+using namespace elma;
+using namespace std::chrono;
+
+// Counts its updates and remembers the thread it was updated on
+class Counter : public Process {
+
+    public:
+
+    Counter(std::string name) : Process(name) {}
+
+    void init() {}
+    void start() {}
+    void update() {
+        count++;
+        thread = std::this_thread::get_id();
+    }
+    void stop() {}
+
+    std::atomic<int> count{0};
+    std::thread::id thread;
+
+};
+
+// Counts how many times the producer had been updated each time it was updated. When both
+// are due at once the producer should go first, so the nth update sees n.
+class Consumer : public Counter {
+
+    public:
+
+    Consumer(std::string name, Counter& producer) : Counter(name), producer(producer) {}
+
+    void update() {
+        Counter::update();
+        if ( producer.count != count ) {
+            out_of_order++;
+        }
+        same_thread = same_thread && producer.thread == thread;
+    }
+
+    Counter& producer;
+    int out_of_order = 0;
+    bool same_thread = true;
+
+};
+
+// Emits an event with its name every update
+class Emitter : public Counter {
+
+    public:
+
+    Emitter(std::string name) : Counter(name) {}
+
+    void init() { tick = event_id("tick"); }
+    void update() {
+        Counter::update();
+        emit(tick, Event("tick", name()));
+    }
+
+    int tick;
+
+};
+
+// Throws on its third update
+class Thrower : public Counter {
+
+    public:
+
+    Thrower() : Counter("thrower") {}
+
+    void update() {
+        Counter::update();
+        if ( count == 3 ) {
+            throw std::runtime_error("thrower gave up");
+        }
+    }
+
+};
+
+// Whether a group holds exactly these processes, in this order
+bool group_is(const std::vector<Process *>& group, std::vector<Process *> expected) {
+    return group == expected;
+}
+
+int main(){
+
+// Dependencies put producers first and split the processes into connected groups
+{
+    Manager m;
+    Counter loner("loner"), a("a"), b("b"), c("c"), producer("producer");
+    Consumer consumer("consumer", producer);
+
+    // Scheduled consumers first, so sorting has to move every producer ahead
+    m.schedule(consumer, 10_ms)
+     .schedule(loner, 10_ms)
+     .schedule(c, 10_ms)
+     .schedule(b, 10_ms)
+     .schedule(a, 10_ms)
+     .schedule(producer, 10_ms)
+     .depends_on(consumer, producer)
+     .depends_on(c, b)
+     .depends_on(b, a);
+
+    std::vector<std::vector<Process *>> groups = m.process_groups();
+    check(groups.size() == 3, "connected processes share a group and the rest have their own");
+    check(groups.size() == 3 && group_is(groups[0], {&loner}), "a process with no dependencies is a group of its own");
+    check(groups.size() == 3 && group_is(groups[1], {&a, &b, &c}), "a chain of dependencies is one group, producers first");
+    check(groups.size() == 3 && group_is(groups[2], {&producer, &consumer}), "a producer comes before its consumer");
+
+    bool threw = false;
+    try {
+        m.depends_on(a, c);
+    } catch (const Exception&) {
+        threw = true;
+    }
+    check(threw, "a dependency that closes a cycle throws");
+    check(m.process_groups() == groups, "a refused dependency leaves the groups and update order as they were");
+
+    threw = false;
+    try {
+        m.depends_on(consumer, consumer);
+    } catch (const Exception&) {
+        threw = true;
+    }
+    check(threw, "a process can't depend on itself");
+
+    Counter unscheduled("unscheduled");
+    threw = false;
+    try {
+        m.depends_on(unscheduled, producer);
+    } catch (const Exception&) {
+        threw = true;
+    }
+    check(threw, "a dependency on an unscheduled process throws");
+}
+
+// In THREADED mode each group runs on its own thread, producers still first
+{
+    Manager m;
+    Counter loner("loner"), producer("producer");
+    Consumer consumer("consumer", producer);
+    m.schedule(consumer, 5_ms)
+     .schedule(producer, 5_ms)
+     .schedule(loner, 5_ms)
+     .depends_on(consumer, producer)
+     .set_execution_mode(Manager::THREADED)
+     .init()
+     .run(200_ms);
+
+    check(consumer.count > 10 && loner.count > 10, "every group is updated");
+    check(consumer.out_of_order == 0, "the producer is updated before its consumer every time");
+    check(consumer.same_thread, "a producer and its consumer are updated on the same thread");
+    check(producer.thread != loner.thread, "separate groups are updated on separate threads");
+    check(producer.thread != std::this_thread::get_id() || loner.thread != std::this_thread::get_id(),
+          "only one group runs on the thread that called run()");
+}
+
+// Events emitted on several threads at once are all handled, on the emitter's thread
+{
+    Manager m;
+    Emitter first("first"), second("second");
+    std::mutex mutex;
+    std::map<std::string, std::set<std::thread::id>> handler_threads;
+    int handled = 0;
+    m.schedule(first, 1_ms)
+     .schedule(second, 1_ms)
+     .set_execution_mode(Manager::THREADED)
+     .init()
+     .watch("tick", [&](Event& e) {
+         std::lock_guard<std::mutex> lock(mutex);
+         handled++;
+         handler_threads[e.value()].insert(std::this_thread::get_id());
+     })
+     .run(100_ms);
+
+    check(first.thread != second.thread, "the emitters run on separate threads");
+    check(handled == first.count + second.count, "every event emitted is handled once");
+    check(handler_threads["first"] == std::set<std::thread::id>{first.thread}
+          && handler_threads["second"] == std::set<std::thread::id>{second.thread},
+          "handlers run on the thread that emitted the event");
+}
+
+// A process that throws stops every thread, and run() rethrows what it threw
+{
+    Manager m;
+    Thrower thrower;
+    Counter loner("loner");
+    m.schedule(thrower, 1_ms)
+     .schedule(loner, 1_ms)
+     .set_execution_mode(Manager::THREADED)
+     .init();
+
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    std::string what;
+    try {
+        m.run(5_s);
+    } catch (const std::runtime_error& e) {
+        what = e.what();
+    }
+    high_resolution_clock::duration taken = high_resolution_clock::now() - start;
+
+    check(what == "thrower gave up", "run() rethrows the exception of the process that threw");
+    check(thrower.count == 3, "the process that threw isn't updated again");
+    check(taken < 1_s, "the other threads stop soon after, rather than running out the runtime");
+    int loner_count = loner.count;
+    std::this_thread::sleep_for(milliseconds(20));
+    check(loner.count == loner_count, "no process is updated after run() returns");
+}
+
+return finish("threaded manager");
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include "elma.h"
+#include "check.h"
+
+// Checks the trace a Manager writes with set_trace_file, that each run's trace
+// holds that run alone, that span names are copied rather than kept as pointers,
+// and that a thread recording more than MAX_EVENTS_PER_THREAD spans has the rest
+// dropped and counted
+
+using namespace elma;
+
+// Does nothing, so its updates are easy to count in the trace
+class Idle : public Process {
+
+    public:
+
+    Idle(std::string name) : Process(name) {}
+
+    void init() {}
+    void start() {}
+    void update() {}
+    void stop() {}
+
+};
+
+// The spans in a trace file, or null if it isn't valid JSON
+json load_trace(std::string file_name){
+    std::ifstream in(file_name);
+    std::stringstream text;
+    text << in.rdbuf();
+    json trace = json::parse(text.str(), nullptr, false);
+    return trace.is_discarded() || !trace.is_object() ? json() : trace["traceEvents"];
+}
+
+// The number of spans in a trace with the given name
+int count_spans(const json& spans, std::string name){
+    int count = 0;
+    for (auto& span : spans){
+        if (span["name"] == name){
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(){
+
+Idle fast("fast \"quoted\" process"), slow("slow process");
+Manager m;
+m.schedule(fast, 10_ms)
+ .schedule(slow, 30_ms)
+ .set_clock_mode(Manager::SIMULATED)
+ .set_trace_file("trace_test.json")
+ .init();
+
+// A span left from before the run shouldn't end up in the run's trace
+Trace::enable();
+{
+    TraceSpan span("before the run");
+}
+Trace::disable();
+
+m.run(300_ms);
+json spans = load_trace("trace_test.json");
+check(spans.is_array() && spans.size() > 0, "the trace is written as JSON with a list of spans");
+
+bool well_formed = spans.is_array();
+for (auto& span : spans){
+    well_formed = well_formed && span["ph"] == "X" && span["name"].is_string() && span["cat"].is_string()
+               && span["ts"].is_number() && span["dur"].is_number() && span["dur"] >= 0 && span["tid"].is_number();
+}
+check(well_formed, "every span has a name, a category, a start and a duration");
+check(count_spans(spans, fast.name()) == fast.num_updates() && count_spans(spans, slow.name()) == slow.num_updates(),
+      "each process update is a span named after the process, including quotes in its name");
+check(count_spans(spans, "Manager::update") > 0, "the manager's updates are traced");
+check(count_spans(spans, "before the run") == 0, "spans recorded before the run are cleared");
+
+// A second run's trace holds the second run alone
+m.run(90_ms);
+spans = load_trace("trace_test.json");
+check(count_spans(spans, fast.name()) == fast.num_updates() && fast.num_updates() < 20,
+      "a second run doesn't add to the spans of the first");
+
+// A span's name only has to last as long as the span
+std::string name = "temporary name";
+Trace::clear();
+Trace::enable();
+{
+    TraceSpan span(name.c_str());
+}
+Trace::disable();
+name.assign("overwritten!!!");
+check(Trace::write("trace_test.json"), "the trace is written directly");
+spans = load_trace("trace_test.json");
+check(count_spans(spans, "temporary name") == 1, "a span's name is copied when it ends");
+
+// One thread recording more than the cap keeps the first MAX_EVENTS_PER_THREAD spans
+const long extra = 10;
+Trace::clear();
+Trace::enable();
+std::thread recorder([extra]() {
+    for (size_t i = 0; i < Trace::MAX_EVENTS_PER_THREAD + extra; i++){
+        TraceSpan span("many");
+    }
+});
+recorder.join();
+Trace::disable();
+check(Trace::dropped() == extra, "spans past the cap are dropped and counted");
+check(Trace::write("trace_test.json"), "a full trace is written");
+// Each span is on a line of its own, which is quicker to count than parsing a million spans
+std::ifstream in("trace_test.json");
+std::string line;
+size_t num_many = 0;
+while (std::getline(in, line)){
+    if (line.find("{\"name\":\"many\"") == 0){
+        num_many++;
+    }
+}
+check(num_many == Trace::MAX_EVENTS_PER_THREAD, "the thread's first MAX_EVENTS_PER_THREAD spans are written");
+Trace::clear();
+check(Trace::dropped() == 0, "clearing the trace resets the dropped count");
+
+std::remove("trace_test.json");
+
+return finish("trace");
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include "typed_channel.h"
+#include "check.h"
+
+// Checks what TypedChannel and SpscChannel do when they fill up, and that
+// they destroy every value they construct
+
+using namespace elma;
+
+// A value that counts how many copies of it are alive
+struct Counted {
+    static int alive;
+    int value;
+    Counted(int v) : value(v) { alive++; }
+    Counted(const Counted& other) : value(other.value) { alive++; }
+    Counted& operator=(const Counted& other) { value = other.value; return *this; }
+    ~Counted() { alive--; }
+};
+
+int Counted::alive = 0;
+
+// Whether calling f throws an elma::Exception
+template <class F>
+bool throws(F f){
+    try {
+        f();
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+void test_typed_channel(){
+
+    TypedChannel<Counted> channel("counted", 3);
+    check(channel.empty(), "a new typed channel is empty");
+    check(throws([&]() { channel.latest(); }), "latest throws on an empty channel");
+    check(throws([&]() { channel.earliest(); }), "earliest throws on an empty channel");
+
+    channel.emplace(1).emplace(2).emplace(3);
+    check(channel.size() == 3 && channel.latest().value == 3 && channel.earliest().value == 1, "a full typed channel");
+
+    // A full channel drops its oldest value to make room
+    channel.emplace(4).send(Counted(5));
+    check(channel.size() == 3, "a full typed channel stays full");
+    check(channel.latest().value == 5 && channel.at(1).value == 4 && channel.earliest().value == 3, "the oldest values are overwritten");
+    check(throws([&]() { channel.at(3); }) && throws([&]() { channel.at(-1); }), "at throws outside the channel");
+    check(Counted::alive == 3, "overwritten values are destroyed");
+
+    channel.flush();
+    check(channel.empty() && Counted::alive == 0, "flush destroys every value");
+
+}
+
+void test_spsc_channel(){
+
+    {
+        SpscChannel<Counted> channel("counted", 3);
+        check(channel.front() == nullptr && !channel.pop(), "a new spsc channel is empty");
+
+        check(channel.emplace(1) && channel.emplace(2) && channel.send(Counted(3)), "values are sent until the channel is full");
+        check(!channel.emplace(4), "a full spsc channel refuses new values");
+        check(channel.size() == 3 && channel.front()->value == 1, "a refused value doesn't replace the oldest one");
+
+        Counted received(0);
+        check(channel.receive(received) && received.value == 1, "values are received oldest first");
+        check(channel.emplace(4) && channel.size() == 3, "receiving makes room");
+
+        bool in_order = true;
+        for (int expected = 2; expected <= 4; expected++){
+            in_order = in_order && channel.front() != nullptr && channel.front()->value == expected;
+            channel.pop();
+        }
+        check(in_order && channel.empty(), "values wrap around the ring in order");
+        // Only received is left
+        check(Counted::alive == 1, "popped values are destroyed");
+
+        channel.emplace(5);
+    }
+    check(Counted::alive == 0, "destroying a spsc channel destroys its values");
+
+    // One thread sends while another receives, with the channel often full
+    SpscChannel<int> channel("ints", 8);
+    const int num_values = 100000;
+    std::thread sender([&]() {
+        for (int i = 0; i < num_values; i++){
+            while (!channel.send(i)){
+                std::this_thread::yield();
+            }
+        }
+    });
+    bool in_order = true;
+    int next = 0, value;
+    while (next < num_values){
+        if (channel.receive(value)){
+            in_order = in_order && value == next;
+            next++;
+        }
+    }
+    sender.join();
+    check(in_order && channel.empty(), "every value sent from another thread is received once, in order");
+
+}
+
+int main(){
+
+test_typed_channel();
+test_spsc_channel();
+
+return finish("typed channel");
+}
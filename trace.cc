@@ -0,0 +1,126 @@
+#include <fstream>
+#include "trace.h"
+
+namespace elma {
+
+    std::atomic<bool> Trace::_enabled(false);
+    steady_clock::time_point Trace::_epoch = steady_clock::now();
+    std::mutex Trace::_buffers_mtx;
+    vector<std::shared_ptr<Trace::Buffer>> Trace::_buffers;
+
+    //! Start recording spans. Spans recorded before are kept, so call clear() first to
+    //! trace a session on its own.
+    void Trace::enable() {
+        _enabled = true;
+    }
+
+    //! Stop recording spans. Spans already recorded are kept until clear() is called.
+    void Trace::disable() {
+        _enabled = false;
+    }
+
+    //! Delete every span recorded so far, on every thread
+    void Trace::clear() {
+        std::lock_guard<std::mutex> lock(_buffers_mtx);
+        for ( auto& buffer : _buffers ) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+            buffer->events.clear();
+            buffer->dropped = 0;
+        }
+    }
+
+    //! Getter
+    //! \return The number of spans dropped because a thread had recorded too many
+    long Trace::dropped() {
+        std::lock_guard<std::mutex> lock(_buffers_mtx);
+        long total = 0;
+        for ( auto& buffer : _buffers ) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+            total += buffer->dropped;
+        }
+        return total;
+    }
+
+    //! Record a finished span on the calling thread. Usually called by TraceSpan.
+    //! The name and category are copied, so they don't have to outlive the call.
+    //! \param name What the span timed
+    //! \param category A group for the span
+    //! \param start When the span started, from now()
+    //! \param duration How long the span took, in nanoseconds
+    void Trace::record(const char * name, const char * category, long long start, long long duration) {
+        Buffer& buffer = thread_buffer();
+        // Only write() and clear() ever wait on this lock
+        std::lock_guard<std::mutex> lock(buffer.mtx);
+        if ( buffer.events.size() < MAX_EVENTS_PER_THREAD ) {
+            buffer.events.push_back({ name, category, start, duration });
+        } else {
+            buffer.dropped++;
+        }
+    }
+
+    // The calling thread's buffer, which is made the first time the thread records a span
+    Trace::Buffer& Trace::thread_buffer() {
+        thread_local Buffer * buffer = nullptr;
+        if ( buffer == nullptr ) {
+            std::lock_guard<std::mutex> lock(_buffers_mtx);
+            _buffers.push_back(std::make_shared<Buffer>());
+            buffer = _buffers.back().get();
+            buffer->thread_id = _buffers.size();
+            buffer->dropped = 0;
+            buffer->events.reserve(4096);
+        }
+        return *buffer;
+    }
+
+    // Write a string as a json string, escaping the characters that need it
+    static void write_json_string(std::ostream& out, const string& s) {
+        out << '"';
+        for ( char c : s ) {
+            if ( c == '"' || c == '\\' ) {
+                out << '\\' << c;
+            } else if ( (unsigned char) c < 0x20 ) {
+                out << ' ';
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    //! Save every span recorded so far as a Chrome trace JSON file. Spans that are
+    //! still open aren't included.
+    //! \param file_name The file to write
+    //! \return Whether the file was written
+    bool Trace::write(const string& file_name) {
+
+        std::ofstream out(file_name);
+        if ( !out.is_open() ) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(_buffers_mtx);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        out.precision(3);
+        out << std::fixed;
+        for ( auto& buffer : _buffers ) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+            for ( const TraceEvent& event : buffer->events ) {
+                out << (first ? "\n" : ",\n") << "{\"name\":";
+                write_json_string(out, event.name);
+                out << ",\"cat\":";
+                write_json_string(out, event.category);
+                // Chrome traces are in microseconds
+                out << ",\"ph\":\"X\",\"ts\":" << event.start / 1000.0
+                    << ",\"dur\":" << event.duration / 1000.0
+                    << ",\"pid\":1,\"tid\":" << buffer->thread_id << "}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+
+        return out.good();
+
+    }
+
+}
@@ -0,0 +1,126 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+namespace elma {
+
+    using std::string;
+    using std::vector;
+    using namespace std::chrono;
+
+    //! A timed span of work on one thread, as recorded by a TraceSpan
+    struct TraceEvent {
+        //! What the span timed
+        string name;
+        //! A group for the span, such as "elma" or "audio", that trace viewers can filter on
+        string category;
+        //! When the span started, in nanoseconds since the program started
+        long long start;
+        //! How long the span took, in nanoseconds
+        long long duration;
+    };
+
+    //! A low overhead tracer for seeing where the time goes in a session.
+
+    //! While tracing is enabled, every TraceSpan records when it starts and how long
+    //! it lasts. Each thread records into its own buffer, so threads never wait on each
+    //! other, and while tracing is disabled a span costs a single atomic load. At the
+    //! end of a session, write() saves every thread's spans as Chrome trace JSON, which
+    //! can be opened in chrome://tracing or https://ui.perfetto.dev.
+    //! The Manager does this for you if given a file with Manager::set_trace_file.
+    //! @code
+    //!     Trace::enable();
+    //!     ...
+    //!     Trace::write("session.json");
+    //! @endcode
+    class Trace {
+
+        public:
+
+        //! The most spans kept for one thread. Later spans are dropped and counted.
+        static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+        static void enable();
+        static void disable();
+        static void clear();
+        static bool write(const string& file_name);
+        static long dropped();
+
+        //! Getter
+        //! \return Whether spans are being recorded
+        static inline bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+        //! \return The time now, in nanoseconds since the program started
+        static inline long long now() {
+            return duration_cast<nanoseconds>(steady_clock::now() - _epoch).count();
+        }
+
+        static void record(const char * name, const char * category, long long start, long long duration);
+
+        private:
+
+        // The spans recorded by one thread. Buffers are kept after their thread exits,
+        // so export threads that have finished still show up in the trace.
+        struct Buffer {
+            int thread_id;
+            std::mutex mtx;
+            vector<TraceEvent> events;
+            long dropped;
+        };
+
+        static Buffer& thread_buffer();
+
+        static std::atomic<bool> _enabled;
+        static steady_clock::time_point _epoch;
+        static std::mutex _buffers_mtx;
+        static vector<std::shared_ptr<Buffer>> _buffers;
+
+    };
+
+    //! Times the scope it is declared in, if tracing is enabled. For example,
+    //! @code
+    //!     void update() {
+    //!         TraceSpan span("detect");
+    //!         ...
+    //!     }
+    //! @endcode
+    class TraceSpan {
+
+        public:
+
+        //! Start the span. The name and category are copied when the span ends, so
+        //! they only have to last as long as the span does.
+        //! \param name What is being timed
+        //! \param category A group for the span
+        TraceSpan(const char * name, const char * category = "elma") :
+          _name(name),
+          _category(category),
+          _start(Trace::enabled() ? Trace::now() : -1) {}
+
+        //! End the span, recording it
+        ~TraceSpan() {
+            if ( _start >= 0 ) {
+                Trace::record(_name, _category, _start, Trace::now() - _start);
+            }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        private:
+
+        const char * _name;
+        const char * _category;
+        long long _start;
+
+    };
+
+}
+
+#endif
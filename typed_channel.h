@@ -0,0 +1,336 @@
+#ifndef TYPED_CHANNEL_H
+#define TYPED_CHANNEL_H
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "exceptions.h"
+
+namespace elma {
+
+    using std::string;
+
+    //! The base class of the typed channels, so a Manager can hold them by name
+    //! whatever type of value they carry.
+    class ChannelBase {
+
+        public:
+
+        //! Constructor
+        //! \param name The name of the channel
+        //! \param capacity The maximum number of values to store in the channel
+        ChannelBase(string name, int capacity) : _name(name), _capacity(capacity) {
+            if ( capacity < 1 ) {
+                throw Exception("A channel must be able to hold at least one value.");
+            }
+        }
+        virtual ~ChannelBase() = default;
+
+        //! Getter
+        //! \return The number of values in the channel
+        virtual int size() = 0;
+
+        //! Getter
+        //! \return Whether the channel is empty
+        inline bool empty() { return size() == 0; }
+
+        //! Getter
+        //! \return Whether the channel is not empty
+        inline bool nonempty() { return size() > 0; }
+
+        //! Getter
+        //! \return The name of the channel
+        inline string name() { return _name; }
+
+        //! Getter
+        //! \return The capacity of the channel
+        inline int capacity() { return _capacity; }
+
+        private:
+
+        string _name;
+        int _capacity;
+
+    };
+
+    //! Fixed-size, uninitialised storage for the values of a typed channel, so values
+    //! can be constructed in place and a channel never allocates after it's made.
+    template <class T>
+    class ChannelSlots {
+
+        public:
+
+        ChannelSlots(int capacity) : _slots(new Slot[capacity]) {}
+
+        //! \return The value in a slot, which must have been constructed
+        inline T& operator[](int index) { return *reinterpret_cast<T*>(&_slots[index]); }
+
+        //! Construct a value in an empty slot
+        template <class... Args>
+        inline void construct(int index, Args&&... args) { new (&_slots[index]) T(std::forward<Args>(args)...); }
+
+        //! Destroy the value in a slot, leaving it empty
+        inline void destroy(int index) { (*this)[index].~T(); }
+
+        private:
+
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+        std::unique_ptr<Slot[]> _slots;
+
+    };
+
+    //! A channel for sending values of any type to and from Process objects
+
+    //! It works like a Channel, keeping the most recent values sent to it, but the values
+    //! are stored as they are rather than as json, in a ring allocated when the channel is
+    //! made. When the ring is full, sending a value replaces the oldest one. Values can be
+    //! constructed in place with emplace, and read by reference.
+    //! Every method locks the channel, so processes running on different threads
+    //! can share it, but a reference returned by latest(), earliest() or at() is only
+    //! good until the value is pushed out of the ring, so a process reading values sent
+    //! from another thread should copy them.
+    //! @code
+    //!     TypedChannel<double> velocity("velocity", 10);
+    //!     m.add_channel(velocity);
+    //!     ...
+    //!     typed_channel<double>("velocity").send(3.41);
+    //!     double v = typed_channel<double>("velocity").latest();
+    //! @endcode
+    template <class T>
+    class TypedChannel : public ChannelBase {
+
+        public:
+
+        //! Constructor
+        //! \param name The name of the channel
+        TypedChannel(string name) : TypedChannel(name, 100) {}
+
+        //! Constructor
+        //! \param name The name of the channel
+        //! \param capacity The maximum number of values to store in the channel
+        TypedChannel(string name, int capacity) :
+          ChannelBase(name, capacity),
+          _slots(capacity),
+          _newest(capacity - 1),
+          _size(0) {}
+
+        ~TypedChannel() { flush(); }
+
+        TypedChannel(const TypedChannel&) = delete;
+        TypedChannel& operator=(const TypedChannel&) = delete;
+
+        //! Send a value
+        //! \param value The value to send into the channel
+        //! \return A reference to the channel, for chaining
+        TypedChannel& send(const T& value) { return emplace(value); }
+
+        //! Send a value, moving it into the channel
+        //! \param value The value to send into the channel
+        //! \return A reference to the channel, for chaining
+        TypedChannel& send(T&& value) { return emplace(std::move(value)); }
+
+        //! Construct a value in the channel
+        //! \param args The arguments to pass to the value's constructor
+        //! \return A reference to the channel, for chaining
+        template <class... Args>
+        TypedChannel& emplace(Args&&... args) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            int index = (_newest + 1) % capacity();
+            if ( _size == capacity() ) {
+                _slots.destroy(index);
+                _size--;
+            }
+            _slots.construct(index, std::forward<Args>(args)...);
+            _newest = index;
+            _size++;
+            return *this;
+        }
+
+        //! Clear the channel, deleting all values in it
+        //! \return A reference to the channel, for chaining
+        TypedChannel& flush() {
+            std::lock_guard<std::mutex> lock(_mtx);
+            for ( int i = 0; i < _size; i++ ) {
+                _slots.destroy(slot(i));
+            }
+            _size = 0;
+            return *this;
+        }
+
+        //! Get the newest value.
+        //! Throws an error if the channel is empty.
+        //! \return A reference to the value
+        const T& latest() {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if ( _size == 0 ) {
+                throw Exception("Tried to get the latest value in an empty channel.");
+            }
+            return _slots[_newest];
+        }
+
+        //! Get the oldest value.
+        //! Throws an error if the channel is empty.
+        //! \return A reference to the value
+        const T& earliest() {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if ( _size == 0 ) {
+                throw Exception("Tried to get the earliest value in an empty channel.");
+            }
+            return _slots[slot(_size - 1)];
+        }
+
+        //! Get a value by its age.
+        //! Throws an error if there is no such value.
+        //! \param index 0 for the newest value, 1 for the one before it, and so on
+        //! \return A reference to the value
+        const T& at(int index) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if ( index < 0 || index >= _size ) {
+                throw Exception("Tried to get a value that isn't in the channel.");
+            }
+            return _slots[slot(index)];
+        }
+
+        //! Getter
+        //! \return The number of values in the channel
+        int size() {
+            std::lock_guard<std::mutex> lock(_mtx);
+            return _size;
+        }
+
+        private:
+
+        // The slot holding the value sent age sends ago
+        inline int slot(int age) { return (_newest - age + capacity()) % capacity(); }
+
+        ChannelSlots<T> _slots;
+        int _newest, _size;
+        std::mutex _mtx;
+
+    };
+
+    //! A lock-free channel for passing values from one process to one other process
+
+    //! Unlike TypedChannel, it's a queue: the receiver reads each value once, oldest
+    //! first, and a full channel refuses new values rather than dropping old ones. Only
+    //! one process may send and only one may receive, but they can be on different
+    //! threads without either ever waiting for a lock.
+    //! @code
+    //!     SpscChannel<AudioPacket> packets("packets", 64);
+    //!     ...
+    //!     // in the sender
+    //!     if ( !spsc_channel<AudioPacket>("packets").emplace(2, 1024) ) { ... full ... }
+    //!     // in the receiver
+    //!     while ( const AudioPacket * packet = spsc_channel<AudioPacket>("packets").front() ) {
+    //!         ...
+    //!         spsc_channel<AudioPacket>("packets").pop();
+    //!     }
+    //! @endcode
+    template <class T>
+    class SpscChannel : public ChannelBase {
+
+        public:
+
+        //! Constructor
+        //! \param name The name of the channel
+        SpscChannel(string name) : SpscChannel(name, 100) {}
+
+        //! Constructor
+        //! \param name The name of the channel
+        //! \param capacity The maximum number of values the channel can hold
+        SpscChannel(string name, int capacity) :
+          ChannelBase(name, capacity),
+          _slots(capacity),
+          _sent(0),
+          _received(0) {}
+
+        ~SpscChannel() {
+            while ( pop() );
+        }
+
+        SpscChannel(const SpscChannel&) = delete;
+        SpscChannel& operator=(const SpscChannel&) = delete;
+
+        //! For the sender. Send a value if there's room.
+        //! \param value The value to send into the channel
+        //! \return Whether the value was sent
+        bool send(const T& value) { return emplace(value); }
+
+        //! For the sender. Send a value if there's room, moving it into the channel.
+        //! \param value The value to send into the channel
+        //! \return Whether the value was sent
+        bool send(T&& value) { return emplace(std::move(value)); }
+
+        //! For the sender. Construct a value in the channel if there's room.
+        //! \param args The arguments to pass to the value's constructor
+        //! \return Whether the value was sent
+        template <class... Args>
+        bool emplace(Args&&... args) {
+            unsigned long sent = _sent.load(std::memory_order_relaxed);
+            if ( sent - _received.load(std::memory_order_acquire) == (unsigned long) capacity() ) {
+                return false;
+            }
+            _slots.construct(sent % capacity(), std::forward<Args>(args)...);
+            _sent.store(sent + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! For the receiver. Get the oldest value without removing it.
+        //! \return A pointer to the value, which stays valid until pop() is called, or nullptr if the channel is empty
+        const T * front() {
+            unsigned long received = _received.load(std::memory_order_relaxed);
+            if ( received == _sent.load(std::memory_order_acquire) ) {
+                return nullptr;
+            }
+            return &_slots[received % capacity()];
+        }
+
+        //! For the receiver. Remove the oldest value.
+        //! \return Whether there was a value to remove
+        bool pop() {
+            unsigned long received = _received.load(std::memory_order_relaxed);
+            if ( received == _sent.load(std::memory_order_acquire) ) {
+                return false;
+            }
+            _slots.destroy(received % capacity());
+            _received.store(received + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! For the receiver. Remove the oldest value, moving it into value.
+        //! \param value Where to put the value
+        //! \return Whether there was a value to receive
+        bool receive(T& value) {
+            const T * oldest = front();
+            if ( oldest == nullptr ) {
+                return false;
+            }
+            value = std::move(*const_cast<T *>(oldest));
+            pop();
+            return true;
+        }
+
+        //! Getter
+        //! \return The number of values waiting to be received
+        int size() {
+            return _sent.load(std::memory_order_acquire) - _received.load(std::memory_order_acquire);
+        }
+
+        private:
+
+        ChannelSlots<T> _slots;
+
+        // These count every value ever sent and received, so their difference is the
+        // number of values in the channel
+        std::atomic<unsigned long> _sent, _received;
+
+    };
+
+}
+
+#endif